@@ -9,6 +9,10 @@
 #include "src-utils/debug_utils.h"
 #include "hardware.h"
 
+// the bus handles held at once: every LCD lane slot, the terminal time sample, one being processed
+// by the LCD and the terminal task, one published by the Output and the GSM task
+static_assert(MessageBus::_buffers >= LCDTask::Lanes::capacity + 1 + 2 + 2, "message bus pool is smaller than the held handles");
+
 // global application instance as singleton and instance acquisition.
 // Application gApp;
 // Application *APPLICATION = &gApp;
@@ -51,6 +55,28 @@ void Application::runtimeStatistic()
     dbgPrint(literals::separator);
     dbgPrint(buff);
     dbgPrint(literals::separator);
+    auto &serial = getInstance()->getGSMTask()->serial();
+    dbgPrint(literals::modemRx, (unsigned)serial.highWater(), (unsigned)serial.overruns(), (unsigned)serial.hwOverruns());
+    auto &modem = getInstance()->getGSMTask()->modem();
+    dbgPrint(literals::modemUrc, (unsigned)modem.pendingEvents(), (unsigned)modem.droppedEvents());
+    auto recovery = modem.lastRecovery();
+    dbgPrint(literals::modemRecoveries, (unsigned)modem.recoveries(), (unsigned)recovery._tier, (unsigned)recovery._elapsedMs);
+    auto &outbox = getInstance()->getGSMTask()->outbox();
+    dbgPrint(literals::smsOutbox, (unsigned)outbox.pending(), (unsigned)outbox.sent(), (unsigned)outbox.merged(), (unsigned)outbox.retries(), (unsigned)outbox.failed());
+    dbgPrint(literals::separator);
+
+    // inter-task queues and the bus
+    auto bus = getInstance()->getBus()->stats();
+    dbgPrint(literals::bus, (unsigned)bus._published, (unsigned)bus._inUse, (unsigned)bus._highWater, (unsigned)bus._exhausted);
+    auto lanes = [](const char *name, const LaneStats &st)
+    {
+        dbgPrint(literals::lanes, name, (unsigned)st._controlHighWater, (unsigned)st._controlDrops, (unsigned)st._coalesced, (unsigned)st._viewDrops);
+    };
+    lanes(literals::tsk_gsm, getInstance()->getGSMTask()->lanes().stats());
+    lanes(literals::tsk_oututs, getInstance()->getOutputTask()->lanes().stats());
+    lanes(literals::tsk_lcd, getInstance()->getLCDTask()->lanes().stats());
+    lanes(literals::tsk_term, getInstance()->getTerminalTask()->lanes().stats());
+    dbgPrint(literals::separator);
 }
 
 bool Application::irqHandlersInit()
@@ -89,6 +115,16 @@ void Application::init()
         if (!irqHandlersInit())
             break;
         components++;
+
+        // topics, before the tasks run
+        if (!_bus.subscribe(Topic::displayLine, &LCDTask::onBus, &_lcd) ||
+            !_bus.subscribe(Topic::telemetry, &LCDTask::onBus, &_lcd) ||
+            !_bus.subscribe(Topic::outputState, &GSMTask::onBus, &_gsm) ||
+            !_bus.subscribe(Topic::outputState, &TerminalTask::onBus, &_terminal) ||
+            !_bus.subscribe(Topic::outputState, &LCDTask::onBus, &_lcd) ||
+            !_bus.subscribe(Topic::time, &TerminalTask::onBus, &_terminal))
+            break;
+        components++;
         
        if (!_heartBeat.init(literals::tsk_led, tskIDLE_PRIORITY + 1ul, configMINIMAL_STACK_SIZE))
             break;
@@ -107,10 +143,6 @@ void Application::init()
             break;
         components++;
 
-        if (!_tick.init())
-            break;
-        components++;
-
         if (!_terminal.init(literals::tsk_term, tskIDLE_PRIORITY + 1ul, 1024))
             break;
         components++;
@@ -18,7 +18,7 @@
 #include "gsm_task.h"
 #include "terminal_task.h"
 #include "output_task.h"
-#include "gsm_tick.h"
+#include "message_bus.h"
 
 /**
  * @brief GSM gateway application class - singleton
@@ -68,6 +68,13 @@ public:
      */
     LCDTask *getLCDTask() { return &_lcd; }
 
+    /**
+     * @brief publish / subscribe between the tasks
+     *
+     * @return MessageBus*
+     */
+    MessageBus *getBus() { return &_bus; }
+
     /**
      * @brief Get GSM&GPS access taks
      *
@@ -82,13 +89,6 @@ public:
      */
     TerminalTask *getTerminalTask() { return &_terminal; }
 
-    /**
-     * @brief Get ticker task - used for refresh status information from GSM modem
-     *
-     * @return GSMTick*
-     */
-    GSMTick *getGSMTick() { return &_tick; }
-
     /**
      * Singleton
     */
@@ -130,10 +130,10 @@ private:
     Application &operator=(const Application &) = delete;
 
 
+    MessageBus _bus;            ///< inter-task topics, before the tasks
     LedTask _heartBeat;         ///< led task instance
     LCDTask _lcd;               ///< lcd task instance
     GSMTask _gsm;               ///< gsm task instance
     TerminalTask _terminal;     ///< terminal task instance
-    GSMTick _tick;              ///< tick task instance
     OutputTask _outputs;        ///< output control task instance
 };
@@ -26,7 +26,6 @@ using namespace std::literals;
  */
 enum class GSMMessageType
 {
-    view,       ///< view display step
     none,       ///< N/A, unknown commnad... aka help
     output1ON,  ///< output 1 -> ON
     output1OFF, ///< output 1 -> OFF
@@ -52,7 +51,9 @@ enum class GSMMessageType
     full,       ///< full commander list
     raccepted,  ///< registration accepted
     rfailed,    ///< registration failed
-    state       ///< output state
+    state,      ///< output state; to the GSM task: Topic::outputState received, see GSMTask::replyState
+    trace,      ///< dump the AT trace to the terminal, _value bit 0 - checksum, bit 1 - clear
+    timepoll    ///< the next time sample after _value [ms], from the terminal task
 };
 
 /**
@@ -63,7 +64,6 @@ struct GSMMessage
 {
     GSMMessageType _messageType{GSMMessageType::none};
     int64_t _value{0};
-    char _message[12];
 };
 
 /**
@@ -11,6 +11,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <algorithm>
 #include "gsm_task.h"
 #include "pico/stdlib.h"
 #include "src-utils/debug_utils.h"
@@ -20,9 +21,24 @@
 #include "application.h"
 #include "sms_command_analyzer.h"
 
-GSMTask::GSMTask() : _gsm(_serial)
+GSMTask::GSMTask() : _gsm(_serial), _outbox(_gsm)
 {
-    _queueGSM = xQueueCreate(5, sizeof(GSMMessage));
+    // background refresh, the operator hardly changes, the time sample period is adaptive
+    _polls.add({gsm::Telemetry::signal, 60000, 2000, 4}, 0);
+    _polls.add({gsm::Telemetry::registration, 60000, 2000, 5}, 0);
+    _polls.add({gsm::Telemetry::gnss, 30000, 1000, 3}, 0);
+    _polls.add({gsm::Telemetry::storage, 300000, 5000, 2}, 0);
+    _polls.add({gsm::Telemetry::provider, 600000, 10000, 1}, 0);
+    _polls.add({gsm::Telemetry::rtc, _timeRetry, 0, 6}, 0);
+    _polls.add({_pollDisplay, 30000, 0, 0, false}, 0);
+
+    // the task sleeps until a request or a received line, both binary semaphores
+    _events = xQueueCreateSet(2);
+    if (_events && _lanes.doorbell() && _serial.rxReady())
+    {
+        xQueueAddToSet(_lanes.doorbell(), _events);
+        xQueueAddToSet(_serial.rxReady(), _events);
+    }
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -30,18 +46,50 @@ GSMTask::GSMTask() : _gsm(_serial)
 GSMTask::~GSMTask()
 {
     done();
-    if (_queueGSM)
-        vQueueDelete(_queueGSM);
+    if (_events)
+    {
+        xQueueRemoveFromSet(_lanes.doorbell(), _events);
+        xQueueRemoveFromSet(_serial.rxReady(), _events);
+        vQueueDelete(_events);
+    }
 }
 
 // -------------------------------------------------------------------------------------------------
 
-void GSMTask::message(const GSMMessage &msg, bool isr)
+bool GSMTask::message(const GSMMessage &msg, bool isr)
 {
-    if (_queueGSM)
-    {
-        (isr) ? xQueueSendToBackFromISR(_queueGSM, (void *)&msg, 0) : xQueueSendToBack(_queueGSM, (void *)&msg, 0);
-    }
+    // only the latest time sample period and output state matter
+    if (msg._messageType == GSMMessageType::timepoll || msg._messageType == GSMMessageType::state)
+        return _lanes.postView(msg, (uint32_t)msg._messageType, isr);
+    return _lanes.post(msg, isr);
+}
+
+bool GSMTask::onBus(void *context, Topic topic, BusRef ref, bool isr)
+{
+    auto self = static_cast<GSMTask *>(context);
+    auto state = Application::getInstance()->getBus()->get<OutputState>(ref);
+    if (!state)
+        return false;
+
+    // no queue round trip, the STATE reply sees the change as soon as it is written, published by the Output task only
+    taskENTER_CRITICAL();
+    if ((int32_t)(state->_seq - self->_outputs._seq) > 0)
+        self->_outputs = *state;
+    taskEXIT_CRITICAL();
+
+    // a STATE reply may wait for this state, see replyState
+    GSMMessage msg;
+    msg._messageType = GSMMessageType::state;
+    self->message(msg, isr);
+    return false;
+}
+
+OutputState GSMTask::outputs() const
+{
+    taskENTER_CRITICAL();
+    auto rc = _outputs;
+    taskEXIT_CRITICAL();
+    return rc;
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -61,7 +109,6 @@ void GSMTask::death()
 void GSMTask::valueStatus(LCDMessageType tp, int32_t value)
 {
     LCDMessage lcdmsg;
-    lcdmsg._message[0] = '\0';
     lcdmsg._value = value;
     lcdmsg._messageType = tp;
     Application::getInstance()->getLCDTask()->message(lcdmsg, false);
@@ -71,15 +118,10 @@ void GSMTask::valueStatus(LCDMessageType tp, int32_t value)
 
 void GSMTask::sendTypeMessage(LCDMessageType tp, const char *msg, bool init)
 {
-    LCDMessage lcdmsg;
-    lcdmsg._messageType = tp;
-    lcdmsg._value = init ? 0 : 1;
-    memset(&lcdmsg._message, 0, sizeof(lcdmsg._message));
-    if (msg)
-    {
-        strncpy(lcdmsg._message, msg, sizeof(lcdmsg._message) - 1);
-    }
-    Application::getInstance()->getLCDTask()->message(lcdmsg, false);
+    DisplayLine line;
+    line._messageType = tp;
+    line._value = init ? 0 : 1;
+    Application::getInstance()->getBus()->publish(Topic::displayLine, line, msg ? msg : "");
 };
 
 // -------------------------------------------------------------------------------------------------
@@ -87,8 +129,20 @@ void GSMTask::sendTypeMessage(LCDMessageType tp, const char *msg, bool init)
 bool GSMTask::simFirstInit()
 {
     bool rc = false;
+    bool simReady = false;
     do
     {
+        // ICCID, PIN and caller ID in one round trip, the separate steps below only diagnose a failure
+        auto sim = _gsm.simSetup(true);
+        if (sim.has_value() && !std::get<0>(sim.value()).empty() && std::get<1>(sim.value()))
+        {
+            sendTypeMessage(LCDMessageType::status, literals::simOK, false);
+            sendTypeMessage(LCDMessageType::status, literals::pinOK, false);
+            sendTypeMessage(LCDMessageType::status, literals::callerIDOK, false);
+            simReady = true;
+            break;
+        }
+
         // chcek SIM
         auto icd = _gsm.getICCID();
         if (icd.has_value())
@@ -140,17 +194,33 @@ bool GSMTask::simFirstInit()
             sendTypeMessage(LCDMessageType::status, literals::callerIError, false);
         }
 
-        // delete SMS storage
-        _gsm.delAllSMS();
+        simReady = true;
+    } while (false);
+
+    do
+    {
+        if (!simReady)
+            break;
+
+        // new SMS in +CMT, the stored +CMTI delivery stays if not supported
+        if (_directSms)
+            _gsm.directSMS(true);
 
-        // registration to network
-        auto isRegisterd = _gsm.isRegistered();
+        // GNSS time and position from the NMEA stream, AT+CGNSINF stays as the fallback
+        if (_gnssStream)
+            _gsm.gnssStream(true);
+
+        // registration to network, the modem may be still searching
+        auto isRegisterd = _gsm.waitRegistered(_registrationWait);
         if (!(isRegisterd.has_value() && isRegisterd.value() == 1))
         {
             sendTypeMessage(LCDMessageType::status, literals::registrationError, false);
             break;
         }
 
+        // commands received while the gateway was off
+        drainInbox();
+
         rc = true;
     } while (false);
     return rc;
@@ -158,111 +228,200 @@ bool GSMTask::simFirstInit()
 
 // -------------------------------------------------------------------------------------------------
 
-bool GSMTask::processMessageView(const GSMMessage &msg)
+void GSMTask::pollView()
 {
-    bool rc = true;
+    auto now = time_us_64();
+    uint8_t items = 0;
 
-    if (msg._value == 0)
+    // SMS traffic first, the refresh waits
+    auto busy = _outbox.pending() > 0 || _draining;
+    for (auto id = _polls.next(now, busy); id.has_value(); id = _polls.next(now, busy))
     {
-        // operator name
-        auto oper = _gsm.getOperator();
-        if (oper.has_value())
+        if (id.value() == _pollDisplay)
+            refreshView();
+        else if (id.value() == gsm::Telemetry::rtc)
+            sampleTime();
+        else
+            items |= (uint8_t)id.value();
+    }
+
+    // the streamed fix is free
+    if (gnssFix().has_value())
+        items &= (uint8_t)~gsm::Telemetry::gnss;
+
+    if (items)
+        requestTelemetry(items);
+}
+
+bool GSMTask::requestTelemetry(uint8_t items)
+{
+    // all items due at the same time in one round trip
+    return _gsm.telemetry(items,
+                          [this, items](std::optional<gsm::Telemetry> tm)
+                          {
+        if (!tm.has_value())
         {
-            sendTypeMessage(LCDMessageType::provider, oper.value().c_str(), false);
-            _failcnt = 0;
-        } else {
-             rc = false;
-             _failcnt ++;
+            // the modem answered the resync after the timeout, the command is only slow
+            if (!_gsm.isResponsive())
+                _failcnt ++;
+            return;
         }
-    }
-    else if (msg._value == 1)
-    {
-        // signal quality
-        auto signal = _gsm.qualitySignal();
-        if (signal.has_value())
+
+        showTelemetry(tm.value(), items);
+
+        // home or roaming
+        if (items & gsm::Telemetry::registration)
         {
-            valueStatus(LCDMessageType::signal, signal.value());
-        } else {
-            rc = false;
+            auto stat = tm.value()._registration;
+            if (stat.has_value() && (stat.value() == 1 || stat.value() == 5))
+                _failcnt = 0;
+            else
+                _failcnt ++;
         }
+
+        // backlog missed by +CMTI / +CMT (e.g. full event queue) grows the storage,
+        // the messages of the failed deletes are deleted by the drain too
+        if (tm.value()._storage.has_value())
+        {
+            auto stored = std::get<0>(tm.value()._storage.value());
+            if (stored > _stored || (stored && _gsm.undeletedSMS()))
+                drainInbox();
+            _stored = stored;
+        } });
+}
+
+void GSMTask::refreshView()
+{
+    if (_learning)
+    {
+        sendTypeMessage(LCDMessageType::idcaller, literals::learning, false);
     }
-    else if (msg._value == 2)
+    else
     {
-        //  RTC
-        auto dm = _gsm.readRTC();
-        if (dm.has_value())
-        {
-            if (TimeUtils::isTimestampCorrect(dm.value()))
-            {
-                TerminalMessage tmmsg;
-                tmmsg._messageType = TerminalMessageType::rtcset;
-                tmmsg._value = TimeUtils::makeUnixTime(dm.value()) ;
-                Application::getInstance()->getTerminalTask()->message(tmmsg, false);
-                auto timestr = TimeUtils::timeToStringShort(dm.value());
-                timestr += literals::gsmTimeOK;
-                sendTypeMessage(LCDMessageType::time, timestr.c_str(), false);
-                auto datestr = TimeUtils::dateToString(dm.value());
-                sendTypeMessage(LCDMessageType::date, datestr.c_str(), false);
-            }
-            else
-            {
-                sendTypeMessage(LCDMessageType::time, literals::gsmTimeError, false);
-            }
-        } 
+        // the last published state, no round trip to the Output task
+        valueStatus(LCDMessageType::outputs, (int32_t)outputs()._mask);
     }
-    else if (msg._value == 3)
+
+    sendTypeMessage(LCDMessageType::backloff, literals::empty, false);
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void GSMTask::showTelemetry(const gsm::Telemetry &tm, uint8_t items)
+{
+    // operator name and signal quality in one event, the registration is checked by AT+CREG?
+    if (tm._operator.has_value() || tm._signal.has_value())
     {
-        // GNSS
-        auto gnss = _gsm.gnssInfo();
-        if (gnss.has_value())
-        {
-            auto [tmxm, fix, stat] = gnss.value();
-            auto timestr = TimeUtils::timeToStringShort(tmxm);
-            timestr += literals::gpsTimeOK;
-            sendTypeMessage(LCDMessageType::time, timestr.c_str(), false);
-            auto datestr = TimeUtils::dateToString(tmxm);
-            sendTypeMessage(LCDMessageType::date, datestr.c_str(), false);
-        }
-        else
-        {
-            sendTypeMessage(LCDMessageType::time, literals::gpsTimeError, false);
-        }
+        TelemetryEvent event;
+        if (tm._signal.has_value())
+            event._signal = tm._signal.value();
+        if (tm._registration.has_value())
+            event._registration = tm._registration.value();
+        Application::getInstance()->getBus()->publish(Topic::telemetry, event, tm._operator.value_or(std::string()));
     }
-    else if (msg._value == 4)
+
+    // one time source per pass, the second one would overwrite the first on the LCD:
+    // GNSS with a fix (the NMEA stream is fresher than AT+CGNSINF), the RTC disciplined by the terminal task
+    auto gnss = tm._gnss;
+    auto streamed = gnssFix();
+    if (streamed.has_value())
+        gnss = std::make_tuple(streamed->_utc, streamed->_valid, true);
+
+    if (gnss.has_value() && std::get<1>(gnss.value()))
     {
-        if (_learning)
-        {
-            sendTypeMessage(LCDMessageType::idcaller, literals::learning, false);
-        }
+        auto tmxm = std::get<0>(gnss.value());
+        auto timestr = TimeUtils::timeToStringShort(tmxm);
+        timestr += literals::gpsTimeOK;
+        sendTypeMessage(LCDMessageType::time, timestr.c_str(), false);
+        auto datestr = TimeUtils::dateToString(tmxm);
+        sendTypeMessage(LCDMessageType::date, datestr.c_str(), false);
     }
-    else if (msg._value == 5)
+    else if (_timebase.isValid())
     {
-        if (_learning)
-        {
-            sendTypeMessage(LCDMessageType::idcaller, literals::learning, false);
-        }
-        else
-        {
-            OutputMsg msgx;
-            msgx._output = 0;
-            msgx._value = false;
-            msgx._messageType = OutputTypeMsg::readall;
-            Application::getInstance()->getOutputTask()->message(msgx, false);
-        }
+        auto dm = _timebase.getTimeDate();
+        auto timestr = TimeUtils::timeToStringShort(dm);
+        timestr += literals::gsmTimeOK;
+        sendTypeMessage(LCDMessageType::time, timestr.c_str(), false);
+        auto datestr = TimeUtils::dateToString(dm);
+        sendTypeMessage(LCDMessageType::date, datestr.c_str(), false);
+    }
+    else
+    {
+        sendTypeMessage(LCDMessageType::time, (items & gsm::Telemetry::gnss) ? literals::gpsTimeError : literals::gsmTimeError, false);
+    }
+}
 
-        sendTypeMessage(LCDMessageType::backloff, literals::empty, false);
-    } else if (msg._value == 6) {
-        //check registration to the network
-        auto isRegisterd = _gsm.isRegistered();
-        if (!(isRegisterd.has_value() && isRegisterd.value() == 1))
+// -------------------------------------------------------------------------------------------------
+
+void GSMTask::sampleTime()
+{
+    // the next one after _timeRetry, unless the terminal task replies with its period
+    do
+    {
+        // the streamed fix is free, no AT round trip
+        auto fix = gnssFix();
+        if (fix.has_value() && fix->_valid)
         {
-            rc = false;
-            _failcnt ++;
-        } else {
-            _failcnt = 0;
+            sendTimeSample((int64_t)TimeUtils::makeUnixTime(fix->_utc) * 1000000ll + fix->_ms * 1000ll, fix->_stamp, _gnssWindow);
+            break;
         }
+
+        // AT+CCLK? alone, the short round trip is the sample window
+        _gsm.telemetry(gsm::Telemetry::rtc, [this](std::optional<gsm::Telemetry> tm)
+                       {
+            if (!tm.has_value() || !tm->_rtc.has_value() || !tm->_rtcStamp || !TimeUtils::isTimestampCorrect(tm->_rtc.value()))
+                return;
+
+            // whole seconds, read between the command and its line
+            auto window = 1000000u + (uint32_t)(tm->_rtcStamp - tm->_sent);
+            sendTimeSample((int64_t)TimeUtils::makeUnixTime(tm->_rtc.value()) * 1000000ll, tm->_rtcStamp, window); });
+    } while (false);
+}
+
+TickType_t GSMTask::nextWait()
+{
+    // events and lines already received, checkStatus reads one line, poll reads all of them
+    if (_gsm.pendingEvents() || !_inbox.empty() || (_serial.isReadable() && !_gsm.isBusy()))
+        return 0;
+
+    auto now = time_us_64();
+    auto deadline = std::min<uint64_t>(_polls.nextDueUs(), _outbox.nextPollUs());
+    auto modem = _gsm.deadline();
+    if (_gsm.isBusy())
+    {
+        // a queued request that could not be sent is tried again
+        deadline = std::min<uint64_t>(deadline, modem ? modem : now + _busyRetry * 1000ull);
+    }
+    else if (modem)
+    {
+        // the end of the +CMT text
+        deadline = std::min<uint64_t>(deadline, modem);
     }
 
+    if (deadline == UINT64_MAX)
+        return portMAX_DELAY;
+
+    // at least one tick, e.g. the outbox waits for the engine queue
+    auto ms = (deadline > now) ? (deadline - now + 999) / 1000 : 0;
+    return std::max<TickType_t>(1, pdMS_TO_TICKS((uint32_t)std::min<uint64_t>(ms, _maxSleep)));
+}
+
+void GSMTask::sendTimeSample(int64_t utcUs, uint64_t stamp, uint32_t window)
+{
+    TimeSample sample;
+    sample._utcUs = utcUs;
+    sample._stamp = stamp;
+    sample._window = window;
+    Application::getInstance()->getBus()->publish(Topic::time, sample);
+}
+
+// -------------------------------------------------------------------------------------------------
+
+std::optional<gsm::GnssFix> GSMTask::gnssFix()
+{
+    auto rc = _gsm.gnssFix();
+    if (rc.has_value() && time_us_64() - rc->_stamp > _gnssFixAge * 1000ull)
+        rc.reset();
     return rc;
 }
 
@@ -270,10 +429,8 @@ bool GSMTask::processMessageView(const GSMMessage &msg)
 
 void GSMTask::startView()
 {
-    // with first faster cycle
-    Application::getInstance()->getGSMTick()->clear();
-    // default refresh period
-    Application::getInstance()->getGSMTick()->start(100);
+    // everything at once, then each item by its period
+    _polls.restart(time_us_64());
     valueStatus(LCDMessageType::init);
     valueStatus(LCDMessageType::signal, 0);
 }
@@ -329,13 +486,16 @@ void GSMTask::loop()
     
         } });
 
+    bool modemUp = false;   // modem powered and initialized
+    bool simUp = false;     // SIM and network setup done
+
     // reinit cycle
     while (true)
     {
         _failcnt = 0;
 
         // modem initialization
-        if (!_gsm.init(true))
+        if (!modemUp && !_gsm.init(true))
         {
             // unrecoverable error, service intervention required
             sendTypeMessage(LCDMessageType::status, literals::gsmError, true);
@@ -345,7 +505,7 @@ void GSMTask::loop()
         // OK status
         sendTypeMessage(LCDMessageType::status, literals::gsmOK, true);
 
-        if (!simFirstInit())
+        if (!simUp && !simFirstInit())
         {
             // unrecoverable error, service intervention required
             death();
@@ -358,21 +518,44 @@ void GSMTask::loop()
         while (true)
         {
 
-            auto res = xQueueReceive(_queueGSM, (void *)&msg, (TickType_t)10 / portTICK_PERIOD_MS);
-            if (res == pdTRUE)
+            // sleeps until a request, a received line or the nearest deadline
+            auto member = xQueueSelectFromSet(_events, nextWait());
+            if (member == (QueueSetMemberHandle_t)_serial.rxReady())
+            {
+                // lines are read below
+                xSemaphoreTake(_serial.rxReady(), 0);
+            }
+            else if (member == (QueueSetMemberHandle_t)_lanes.doorbell())
+            {
+                // all waiting requests, the control lane first
+                xSemaphoreTake(_lanes.doorbell(), 0);
+            }
+
+            while (_lanes.tryReceive(msg))
             {
-                if (msg._messageType == GSMMessageType::view)
+                if (msg._messageType == GSMMessageType::trace)
                 {
-                    processMessageView(msg);
+                    sendTrace((msg._value & 1) != 0, (msg._value & 2) != 0);
                 }
 
                 if (msg._messageType == GSMMessageType::state)
                 {
-                    _lastOut = msg._message;
+                    replyState();
+                }
+
+                if (msg._messageType == GSMMessageType::timepoll)
+                {
+                    _polls.reschedule(gsm::Telemetry::rtc, time_us_64() + (uint64_t)msg._value * 1000ull);
                 }
             }
 
-            // gsm modem status ring, new sms ...
+            // background refresh, outgoing SMS, queued modem requests, completions are reported by callbacks
+            pollView();
+            _outbox.poll(time_us_64());
+            _gsm.poll();
+            processInbox();
+
+            // gsm modem status ring, new sms ... only what has been received, the loop is woken by the next line
             processGSMStatus();
 
             if (_failcnt > _maxfails)  {
@@ -380,6 +563,25 @@ void GSMTask::loop()
                 break;
             }
         }
+
+        // the cheapest step that brings the modem back, power cycle as the last resort
+        auto report = _gsm.recover(true);
+        dbgPrint(literals::modemRecovery, (unsigned)report._tier, (unsigned)report._elapsedMs);
+        if (report._tier == gsm::RecoveryTier::failed)
+        {
+            // unrecoverable error, service intervention required
+            sendTypeMessage(LCDMessageType::status, literals::gsmError, true);
+            death();
+        }
+
+        // the modem is initialized by the recovery, SIM setup only after the power cycle
+        modemUp = true;
+        simUp = report._tier != gsm::RecoveryTier::powerCycle;
+
+        // commands received during the outage
+        _draining = false;
+        if (simUp)
+            drainInbox();
     }
 }
 
@@ -389,7 +591,6 @@ void GSMTask::ringOperation(std::string_view callerId)
 {
 
     // learning operation
-    Application::getInstance()->getGSMTick()->stop(100);
     sendTypeMessage(LCDMessageType::status, literals::registration, true);
     sendTypeMessage(LCDMessageType::status, std::string(callerId).c_str(), false);
     if (_commander.isEmpty())
@@ -450,7 +651,8 @@ void GSMTask::sendSMSReply(GSMMessageType r, std::string_view id)
     case GSMMessageType::state:
         smsContent = literals::smsCOutputs;
         smsContent += "\n";
-        smsContent += _lastOut;
+        smsContent += literals::output;
+        smsContent += OutputTask::outputsToString(outputs()._mask);
         break;
 
     case GSMMessageType::add:
@@ -477,13 +679,48 @@ void GSMTask::sendSMSReply(GSMMessageType r, std::string_view id)
     if (!smsContent.empty())
     {
        dbgLog("SENDSMS :>%s<\n", smsContent.c_str()); 
-       _gsm.sendSMS(id, smsContent);
+       if (!_outbox.send(id, smsContent))
+           dbgLog("SENDSMS :>queue full<\n");
     }
 }
 
 // -------------------------------------------------------------------------------------------------
 
-void GSMTask::smsOperation(std::string msg, std::string id, const datetime_t &tmx)
+void GSMTask::replyState()
+{
+    // e.g. "OUT1 ON" and "STATE" in one drain, the reply includes the write
+    if (_stateReplies.empty() || (int32_t)(outputs()._seq - _written) < 0)
+        return;
+
+    for (const auto &id : _stateReplies)
+        sendSMSReply(GSMMessageType::state, id);
+    _stateReplies.clear();
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void GSMTask::sendTrace(bool checksum, bool clear)
+{
+    // the trace is written by this task only, the terminal task prints the copy
+    auto records = std::make_unique<std::vector<gsm::TraceRecord>>();
+    records->reserve(_gsm.trace().size());
+    _gsm.trace().forEach([&records](const gsm::TraceRecord &r)
+                         { records->push_back(r); });
+
+    TerminalMessage msg;
+    msg._messageType = TerminalMessageType::trace;
+    msg._value = checksum ? 1 : 0;
+    msg._trace = records.get();
+    if (Application::getInstance()->getTerminalTask()->message(msg, false))
+        records.release();
+
+    if (clear)
+        _gsm.trace().clear();
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void GSMTask::smsOperation(std::string msg, std::string id, const datetime_t &tmx, std::optional<uint32_t> index)
 {
 
     do
@@ -492,7 +729,6 @@ void GSMTask::smsOperation(std::string msg, std::string id, const datetime_t &tm
         if (!_commander.isExist(id))
             break;
 
-        Application::getInstance()->getGSMTick()->stop(100);
         sendTypeMessage(LCDMessageType::status, literals::smsCommand, true);
         sendTypeMessage(LCDMessageType::status, std::string(id).c_str(), false);
 
@@ -537,7 +773,9 @@ void GSMTask::smsOperation(std::string msg, std::string id, const datetime_t &tm
         // output state
         if (cmd == GSMMessageType::state) 
         {
-            sendSMSReply(GSMMessageType::state, id);
+            // after the writes of the previous commands
+            _stateReplies.push_back(id);
+            replyState();
             // send list of all users
             // SMS: list of users
             break;
@@ -561,7 +799,8 @@ void GSMTask::smsOperation(std::string msg, std::string id, const datetime_t &tm
             msgx._output = pin;
             msgx._value = onOff;
             msgx._messageType = OutputTypeMsg::writeAllOff;
-            Application::getInstance()->getOutputTask()->message(msgx, false);
+            if (auto seq = Application::getInstance()->getOutputTask()->message(msgx, false))
+                _written = seq;
             sendSMSReply(GSMMessageType::accepted, id);
         }
 
@@ -575,24 +814,52 @@ void GSMTask::smsOperation(std::string msg, std::string id, const datetime_t &tm
             msgx._output = pin;
             msgx._value = onOff;
             msgx._messageType = OutputTypeMsg::writeone;
-            Application::getInstance()->getOutputTask()->message(msgx, false);
+            if (auto seq = Application::getInstance()->getOutputTask()->message(msgx, false))
+                _written = seq;
             sendSMSReply(GSMMessageType::accepted, id);
         }
 
     } while (false);
 
-    // delete last sms
-    _gsm.delSMS(_gsm.incomingSMSIndex());
+    // delete processed sms, the direct one is not stored
+    if (index.has_value())
+        _gsm.delSMS(index.value());
 
     startView();
 }
 
 // -------------------------------------------------------------------------------------------------
 
+void GSMTask::drainInbox()
+{
+    if (_draining)
+        return;
+
+    _draining = _gsm.drainInbox([this](std::optional<std::vector<gsm::SmsMessage>> inbox)
+                                {
+        _draining = false;
+        if (!inbox.has_value())
+            return;
+
+        for (auto &sms : inbox.value())
+            _inbox.push_back(std::move(sms)); });
+}
+
+void GSMTask::processInbox()
+{
+    // smsOperation may wait for the modem, the engine callback must not
+    auto inbox = std::move(_inbox);
+    _inbox.clear();
+    for (const auto &[msg, id, tmx] : inbox)
+        smsOperation(msg, id, tmx, std::nullopt);
+}
+
+// -------------------------------------------------------------------------------------------------
+
 bool GSMTask::processGSMStatus()
 {
     bool rc = true;
-    auto stx = _gsm.checkStatus();
+    auto stx = _gsm.checkStatus(0);
 
     if (stx == gsm::ResponseStatus::callerid)
     {
@@ -614,12 +881,19 @@ bool GSMTask::processGSMStatus()
 
     if (stx == gsm::ResponseStatus::newsms)
     {
+        // the burst of messages is read at once
+        sendTypeMessage(LCDMessageType::backlon, literals::empty, false);
+        drainInbox();
+    }
+    else if (stx == gsm::ResponseStatus::directsms)
+    {
+        // the whole message in +CMT, no storage round trips
         sendTypeMessage(LCDMessageType::backlon, literals::empty, false);
-        auto xsms = _gsm.readSMS(_gsm.incomingSMSIndex());
+        auto xsms = _gsm.incomingSMS();
         if (xsms.has_value())
         {
             auto [msg, id, tmx] = xsms.value();
-            smsOperation(msg, id, tmx);
+            smsOperation(msg, id, tmx, std::nullopt);
         }
     } else {
         rc = false;
@@ -15,11 +15,16 @@
 #include <string_view>
 #include "rptask.h"
 #include "src-gsm/gsm.h"
+#include "src-gsm/sms_outbox.h"
 #include "hardware.h"
 #include "gsm_message.h"
 #include "serial_impl.h"
 #include "lcd_message.h"
+#include "output_msg.h"
 #include "commanders.h"
+#include "src-utils/time_base.h"
+#include "src-utils/poll_scheduler.h"
+#include "src-utils/message_lanes.h"
 
 /**
  * @brief GSM module task - encapsulates the complete work with GSM modem, getting status, reading commands, etc. 
@@ -34,7 +39,63 @@ public:
 
 	virtual bool init(const char *name, UBaseType_t priority = tskIDLE_PRIORITY, const configSTACK_DEPTH_TYPE stackDepth = configMINIMAL_STACK_SIZE) override;
 
-	void message(const GSMMessage &msg, bool isr);
+	/**
+	 * @brief the time sample period and the output state are coalesced, the rest in the control lane
+	 * 
+	 * @param msg 
+	 * @param isr 
+	 * @return true - queued
+	 */
+	bool message(const GSMMessage &msg, bool isr);
+
+	/**
+	 * @brief MessageBus subscriber, Topic::outputState, copied in the publisher context,
+	 * the waiting STATE replies are woken by GSMMessageType::state
+	 * 
+	 * @param context - GSMTask
+	 * @param topic 
+	 * @param ref - OutputState
+	 * @param isr 
+	 * @return false - not kept
+	 */
+	static bool onBus(void *context, Topic topic, BusRef ref, bool isr);
+
+	/**
+	 * @brief the latest output state, updated by Topic::outputState
+	 * 
+	 * @return OutputState 
+	 */
+	OutputState outputs() const;
+
+	using Lanes = MessageLanes<GSMMessage, 4, 2>;
+
+	/**
+	 * @brief request queue, overflow statistics
+	 *
+	 * @return const Lanes&
+	 */
+	const Lanes &lanes() const { return _lanes; }
+
+	/**
+	 * @brief access to the modem serial line, RX statistics
+	 *
+	 * @return const gsm::SerialImpl&
+	 */
+	const gsm::SerialImpl &serial() const { return _serial; }
+
+	/**
+	 * @brief access to the modem driver, event statistics
+	 *
+	 * @return const gsm::GSM&
+	 */
+	const gsm::GSM &modem() const { return _gsm; }
+
+	/**
+	 * @brief access to the outgoing SMS queue, statistics
+	 *
+	 * @return const gsm::SmsOutbox&
+	 */
+	const gsm::SmsOutbox &outbox() const { return _outbox; }
 
 protected:
 
@@ -76,11 +137,32 @@ protected:
 	bool simFirstInit();
 
 	/**
-	 * @brief processing of cyclical data displays from the modem
+	 * @brief background refresh, the due items of _polls, the modem ones in one telemetry request
+	 * 
+	 */
+	void pollView();
+
+	/**
+	 * @brief batched modem query, the result is displayed, the registration is checked
+	 * 
+	 * @param items - gsm::Telemetry bits
+	 * @return true - queued
+	 */
+	bool requestTelemetry(uint8_t items);
+
+	/**
+	 * @brief learning info or the output states, the backlight off
 	 * 
-	 * @param msg 
 	 */
-	bool processMessageView(const GSMMessage& msg);
+	void refreshView();
+
+	/**
+	 * @brief displays the values of the batched modem query
+	 * 
+	 * @param tm 
+	 * @param items - requested gsm::Telemetry bits
+	 */
+	void showTelemetry(const gsm::Telemetry &tm, uint8_t items);
 
 	/**
 	 * @brief checks GSM modem states
@@ -94,8 +176,21 @@ protected:
 	 * @param msg - message content
 	 * @param id - caller ID - phone number
 	 * @param tmx  - timestamp 
+	 * @param index - storage index of the message, std::nullopt - not stored (+CMT) or already deleted (inbox drain)
+	 */
+	void smsOperation(std::string msg, std::string id, const datetime_t& tmx, std::optional<uint32_t> index);
+
+	/**
+	 * @brief all unread messages in one round trip, processed in the arrival order
+	 * 
 	 */
-	void smsOperation(std::string msg, std::string id, const datetime_t& tmx);
+	void drainInbox();
+
+	/**
+	 * @brief the drained messages, smsOperation is not called from the engine callback
+	 * 
+	 */
+	void processInbox();
 
 	/**
 	 * @brief processing of the callback as a registration, if enabled
@@ -105,28 +200,91 @@ protected:
 	void ringOperation(std::string_view callerId);
 
 	/**
-	 * @brief start of operation view
+	 * @brief reference time for the terminal clock, GNSS fix or the modem RTC, the _polls item gsm::Telemetry::rtc,
+	 * the period is returned by the terminal task (GSMMessageType::timepoll)
+	 * 
+	 */
+	void sampleTime();
+
+	/**
+	 * @brief sends the time sample to the terminal task
+	 * 
+	 * @param utcUs - reference UTC [us]
+	 * @param stamp - local time of the reference [us]
+	 * @param window - the true time lies in <utcUs, utcUs + window) [us]
+	 */
+	void sendTimeSample(int64_t utcUs, uint64_t stamp, uint32_t window);
+
+	/**
+	 * @brief blocking time of the loop, up to the nearest deadline (time sample, SMS backoff,
+	 * request timeout), 0 if the received events are not processed yet
 	 * 
+	 * @return TickType_t 
+	 */
+	TickType_t nextWait();
+
+	/**
+	 * @brief the streamed GNSS fix, if it is fresh
+	 *
+	 * @return std::optional<gsm::GnssFix> - std::nullopt if the stream is off or stalled
+	 */
+	std::optional<gsm::GnssFix> gnssFix();
+
+	/**
+	 * @brief start of operation view
+	 *
 	 */
 	void startView();
 
 	/**
-	 * @brief SMS replay
+	 * @brief SMS replay, queued in the outbox
 	 * 
 	 * @param r - message type
 	 * @param id - recepient number
 	 */
 	void sendSMSReply(GSMMessageType r, std::string_view id);
 
+	/**
+	 * @brief the waiting STATE replies, once the outputs include the last write of this task
+	 * 
+	 */
+	void replyState();
+
+	/**
+	 * @brief copy of the AT trace for the terminal task, it prints the records
+	 * 
+	 * @param checksum - responses with the checksum
+	 * @param clear - the trace is cleared after the copy
+	 */
+	void sendTrace(bool checksum, bool clear);
+
 	
 private:
 	const uint32_t	_maxfails{5};	///< numbers of modem fails communication before restart
+	const uint32_t	_registrationWait{60000};	///< [ms] network search after the modem start
+	const bool		_directSms{true};			///< new SMS delivered by +CMT instead of the SIM storage
+	const bool		_gnssStream{true};			///< GNSS from the NMEA stream instead of AT+CGNSINF polling
+	const uint32_t	_gnssFixAge{3000};			///< [ms] the streamed fix is not older, 1 Hz RMC
+	const uint32_t	_gnssWindow{300000};		///< [us] NMEA output follows the fix epoch, receiver dependent
+	const uint32_t	_timeRetry{30000};			///< [ms] the next time sample, until the terminal task replies
+	const uint32_t	_busyRetry{10};				///< [ms] a queued request, the engine did not send it
+	const uint32_t	_maxSleep{600000};			///< [ms] the longest loop sleep, over the longest time sample period
+	static constexpr uint32_t _pollDisplay{0x100};	///< _polls item of refreshView, above the gsm::Telemetry bits
+	PollScheduler _polls;			///< background refresh, gsm::Telemetry items and _pollDisplay
+	TimeBase _timebase;				///< RP2040 RTC, kept by the terminal task
 	uint32_t _failcnt{0};			///< numbers of failes
-	QueueHandle_t _queueGSM;		///< RTOS queue of requests
+	Lanes _lanes;					///< requests
+	QueueSetHandle_t _events{nullptr};	///< doorbell of _lanes and the received line of _serial
 	gsm::SerialImpl _serial;		///< hardware-dependent implementation
 	gsm::GSM _gsm;					///< gsm modem instance
+	gsm::SmsOutbox _outbox;			///< outgoing SMS, sent in the background
 	bool _statusBlocker{false}; 	///< round robin status reader active
 	bool _learning{false};			///< waiting for ring learning
+	bool _draining{false};			///< inbox drain in progress
+	std::vector<gsm::SmsMessage> _inbox;	///< drained messages, see processInbox
+	uint32_t _stored{0};			///< messages in the storage by the last AT+CPMS?, a new one triggers the drain
 	Commanders  _commander;			///< collected all those who have the power to control the GSM gate 
-	std::string _lastOut;			///< last state of outputs
+	OutputState _outputs;			///< the latest Topic::outputState, the STATE reply
+	uint32_t _written{0};			///< OutputState::_seq of the last write of this task
+	std::vector<std::string> _stateReplies;	///< STATE senders waiting for _written
 };
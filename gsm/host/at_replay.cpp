@@ -0,0 +1,371 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   at_replay.cpp
+/// @author Petr Vanek
+///
+/// Replays the AT trace dumped by the terminal command TD; through the GSM driver.
+/// The recorded modem responses are released with the recorded delays after each
+/// command the driver sends, optionally the same commands run against the simulator.
+///
+/// gsm_at_replay <dump file> [--sim]
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include "sim_modem.h"
+#include "src-gsm/gsm.h"
+
+using namespace gsm;
+
+namespace {
+
+constexpr char C_CTRLZ{0x1a};
+constexpr uint64_t C_MS{1000};
+
+/**
+ * @brief one transmitted unit (command or SMS payload) and the data received after it
+ *
+ */
+struct Unit
+{
+    uint64_t _us{0};                                    ///< recorded end of the transmission
+    std::string _tx;                                    ///< including the terminator
+    std::vector<std::pair<uint64_t, std::string>> _rx;  ///< [us] offset from _us, data
+};
+
+/**
+ * @brief the request rebuilt from the units
+ *
+ */
+struct Step
+{
+    std::string _command;
+    std::string _payload;
+    std::string _recorded;                              ///< final status seen in the trace
+};
+
+/**
+ * @brief the modem played from the capture
+ *
+ */
+class ReplayModem : public ISerialModem
+{
+public:
+    explicit ReplayModem(std::vector<Unit> units, const std::vector<std::pair<uint64_t, std::string>> &preamble) : _units(std::move(units))
+    {
+        for (auto &[offset, data] : preamble)
+            schedule(offset, data);
+    }
+
+    bool isReadable() override
+    {
+        return !_out.empty() && _out.front().first <= _now;
+    }
+
+    std::size_t read(char *buffer, std::size_t size, char delimiter) override
+    {
+        std::size_t cnt = 0;
+        while (cnt < size && isReadable())
+        {
+            auto &front = _out.front();
+            char c = front.second.front();
+            front.second.erase(0, 1);
+            if (front.second.empty())
+                _out.pop_front();
+
+            buffer[cnt++] = c;
+            if (c == delimiter)
+                break;
+        }
+        return cnt;
+    }
+
+    std::size_t write(std::string_view data) override
+    {
+        for (auto c : data)
+        {
+            _in += c;
+            if (c != '\n')
+                continue;
+
+            // the driver finished the unit, the recorded answer follows
+            if (_next < _units.size())
+            {
+                auto &unit = _units[_next++];
+                if (unit._tx != _in)
+                    _mismatches++;
+                for (auto &[offset, rx] : unit._rx)
+                    schedule(_now + offset, rx);
+            }
+            else
+            {
+                _mismatches++;
+            }
+            _in.clear();
+        }
+        return data.size();
+    }
+
+    void delay(uint16_t ms) override
+    {
+        _now += ms * C_MS;
+    }
+
+    uint64_t getus() override
+    {
+        return ++_now;
+    }
+
+    bool waitReadable(uint32_t maxWait) override
+    {
+        if (isReadable())
+            return true;
+
+        auto until = _now + maxWait * C_MS;
+        if (!_out.empty())
+            until = std::min(until, std::max(_now, _out.front().first));
+        _now = until;
+        return isReadable();
+    }
+
+    void hardwareInit() override {}
+    void modemInit() override {}
+
+    uint32_t mismatches() const { return _mismatches; }
+
+private:
+    void schedule(uint64_t at, const std::string &data)
+    {
+        // ordered by time, the same time keeps the recorded order
+        auto it = std::upper_bound(_out.begin(), _out.end(), at, [](uint64_t t, const auto &p)
+                                   { return t < p.first; });
+        _out.insert(it, {at, data});
+    }
+
+    std::vector<Unit> _units;
+    std::size_t _next{0};
+    std::deque<std::pair<uint64_t, std::string>> _out;
+    std::string _in;
+    uint64_t _now{0};
+    uint32_t _mismatches{0};
+};
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/**
+ * @brief "TD<us> <T|R> <hex>;" records, anything else on the line is ignored
+ *
+ * @param path
+ * @param units
+ * @param preamble - received before the first command
+ * @return true
+ */
+bool load(const char *path, std::vector<Unit> &units, std::vector<std::pair<uint64_t, std::string>> &preamble)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+
+    std::string line, tx;
+    uint64_t start = 0;
+    bool first = true;
+    while (std::getline(in, line))
+    {
+        auto pos = line.find("TD");
+        if (pos == std::string::npos)
+            pos = line.find("Td");
+        if (pos == std::string::npos)
+            continue;
+
+        uint64_t us = 0;
+        char dir = 0;
+        char hex[2 * TraceRecord::_capacity + 1]{};
+        if (sscanf(line.c_str() + pos + 2, "%llu %c %108[0-9A-Fa-f]", (unsigned long long *)&us, &dir, hex) != 3)
+            continue;
+
+        std::string data;
+        for (std::size_t i = 0; hex[i] && hex[i + 1]; i += 2)
+            data += (char)(hexValue(hex[i]) << 4 | hexValue(hex[i + 1]));
+
+        if (first)
+        {
+            start = us;
+            first = false;
+        }
+
+        if (dir == 'R')
+        {
+            if (units.empty())
+                preamble.emplace_back(us - start, data);
+            else
+                units.back()._rx.emplace_back(us - units.back()._us, data);
+            continue;
+        }
+
+        for (auto c : data)
+        {
+            tx += c;
+            if (c != '\n')
+                continue;
+            Unit unit;
+            unit._us = us;
+            unit._tx = tx;
+            units.push_back(std::move(unit));
+            tx.clear();
+        }
+    }
+
+    // the oldest command may be cut by the ring
+    if (!units.empty() && units.front()._tx.substr(0, 2) != "AT")
+    {
+        for (auto &[offset, data] : units.front()._rx)
+            preamble.emplace_back(offset + units.front()._us - start, data);
+        units.erase(units.begin());
+    }
+    return true;
+}
+
+std::string outcome(const std::string &rx)
+{
+    if (rx.find("\r\nOK\r\n") != std::string::npos || rx.rfind("OK\r\n", 0) == 0)
+        return "OK";
+    if (rx.find("ERROR") != std::string::npos)
+        return "ERROR";
+    return "-";
+}
+
+std::vector<Step> steps(const std::vector<Unit> &units)
+{
+    std::vector<Step> rc;
+    for (std::size_t i = 0; i < units.size(); i++)
+    {
+        Step step;
+        std::string rx;
+        step._command = units[i]._tx.substr(0, units[i]._tx.find_first_of("\r\n"));
+        for (auto &r : units[i]._rx)
+            rx += r.second;
+
+        // AT+CMGS, the payload is the next unit
+        if (i + 1 < units.size())
+        {
+            auto &next = units[i + 1]._tx;
+            auto end = next.find(C_CTRLZ);
+            if (end != std::string::npos)
+            {
+                step._payload = next.substr(0, end);
+                for (auto &r : units[i + 1]._rx)
+                    rx += r.second;
+                i++;
+            }
+        }
+        step._recorded = outcome(rx);
+        rc.push_back(std::move(step));
+    }
+    return rc;
+}
+
+/**
+ * @brief runs the request to the completion, the events are drained after it
+ *
+ * @return std::pair<bool, uint64_t> - success, [ms]
+ */
+std::pair<bool, uint64_t> run(GSM &modem, ISerialModem &serial, const Step &step, std::vector<uint32_t> &events)
+{
+    bool success = false;
+    AtRequest request;
+    request._command = step._command;
+    request._payload = step._payload;
+    request._callback = [&](bool ok, ATParser &)
+    {
+        success = ok;
+    };
+
+    auto t = serial.getus();
+    modem.submit(request);
+    while (modem.poll(100))
+        ;
+    auto ms = (serial.getus() - t) / C_MS;
+
+    while (modem.pendingEvents() || serial.isReadable())
+    {
+        auto status = modem.checkStatus(0);
+        events[(std::size_t)status]++;
+    }
+    return {success, ms};
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <dump file> [--sim]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<Unit> units;
+    std::vector<std::pair<uint64_t, std::string>> preamble;
+    if (!load(argv[1], units, preamble))
+    {
+        fprintf(stderr, "%s: cannot read\n", argv[1]);
+        return 2;
+    }
+    bool withSim = argc > 2 && strcmp(argv[2], "--sim") == 0;
+
+    auto script = steps(units);
+    ReplayModem replay(units, preamble);
+    GSM modem(replay);
+    SimModem sim;
+    GSM simModem(sim);
+
+    static const char *names[]{"ok", "error", "status", "unknown", "clock", "smsready", "busy",
+                               "ring", "nocarrier", "newsms", "callerid", "nodial", "msgnum", "directsms"};
+    std::vector<uint32_t> events(std::size(names)), simEvents(std::size(names));
+    uint32_t differs = 0;
+
+    printf("%-4s %-32s %-8s %-8s %8s %s\n", "#", "command", "trace", "replay", "ms", withSim ? "sim" : "");
+    for (std::size_t i = 0; i < script.size(); i++)
+    {
+        auto &step = script[i];
+        auto [ok, ms] = run(modem, replay, step, events);
+        std::string simResult;
+        if (withSim)
+        {
+            auto [simOk, simMs] = run(simModem, sim, step, simEvents);
+            simResult = simOk ? "ok" : "failed";
+            if (simOk != ok)
+                differs++;
+        }
+        printf("%-4zu %-32.32s %-8s %-8s %8llu %s\n", i + 1, step._command.c_str(), step._recorded.c_str(),
+               ok ? "ok" : "failed", (unsigned long long)ms, simResult.c_str());
+    }
+
+    printf("events:");
+    for (std::size_t i = 0; i < events.size(); i++)
+    {
+        if (events[i] && i != (std::size_t)ResponseStatus::unknown)
+            printf(" %s %u", names[i], events[i]);
+    }
+    printf("\ntx mismatches %u", replay.mismatches());
+    if (withSim)
+        printf(", simulator differs in %u of %zu", differs, script.size());
+    printf("\n");
+    return replay.mismatches() ? 1 : 0;
+}
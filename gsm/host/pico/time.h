@@ -0,0 +1,13 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   time.h
+/// @author Petr Vanek
+
+#pragma once
+
+// host build, the driver takes the time from ISerialModem::getus()
+
+#include <stdint.h>
+#include "pico/util/datetime.h"
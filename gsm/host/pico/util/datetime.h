@@ -0,0 +1,23 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   datetime.h
+/// @author Petr Vanek
+
+#pragma once
+
+// host build, the pico-sdk type used by the driver
+
+#include <stdint.h>
+
+typedef struct
+{
+    int16_t year;   ///< 0..4095
+    int8_t month;   ///< 1..12
+    int8_t day;     ///< 1..31
+    int8_t dotw;    ///< 0..6, 0 is Sunday
+    int8_t hour;    ///< 0..23
+    int8_t min;     ///< 0..59
+    int8_t sec;     ///< 0..59
+} datetime_t;
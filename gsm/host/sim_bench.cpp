@@ -0,0 +1,161 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   sim_bench.cpp
+/// @author Petr Vanek
+
+#include <stdio.h>
+#include <chrono>
+#include "sim_modem.h"
+#include "src-gsm/gsm.h"
+#include "src-utils/poll_scheduler.h"
+
+using namespace gsm;
+
+namespace {
+
+/**
+ * @brief virtual time of the step [ms]
+ *
+ */
+template <typename F>
+uint64_t measure(SimModem &sim, F step)
+{
+    auto t = sim.getus();
+    step();
+    return (sim.getus() - t) / 1000;
+}
+
+void boot()
+{
+    SimModem sim(SimModem::Profile{}, false);
+    GSM modem(sim);
+
+    bool rc = false;
+    auto ms = measure(sim, [&]()
+                      { rc = modem.init(true) && modem.simSetup(true).has_value() && modem.waitRegistered(60000) == 1; });
+    printf("boot          %-5s %8llu ms  %zu commands\n", rc ? "ok" : "FAIL", (unsigned long long)ms, sim.commands().size());
+}
+
+void telemetry(uint32_t count, uint32_t noisePpm, bool nmea = false)
+{
+    SimModem sim;
+    GSM modem(sim);
+    if (nmea)
+        modem.gnssPower(true) && modem.gnssStream(true);
+    sim.noise(noisePpm);
+
+    uint32_t ok = 0;
+    auto wall = std::chrono::steady_clock::now();
+    auto ms = measure(sim, [&]()
+                      {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto tm = modem.telemetry(Telemetry::all);
+            if (tm.has_value() && tm->_signal.has_value() && tm->_rtc.has_value())
+                ok++;
+        } });
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wall).count();
+
+    printf("telemetry     %5u/%-5u %6llu ms  %.1f req/s  noise %u ppm  host %.1f us/req", ok, count,
+           (unsigned long long)ms, ms ? count * 1000.0 / ms : 0.0, noisePpm, (double)us / count);
+    if (nmea)
+        printf("  nmea %u sentences", modem.nmea().sentences());
+    printf("\n");
+}
+
+void inbox(uint32_t count)
+{
+    SimModem sim;
+    GSM modem(sim);
+
+    for (uint32_t i = 0; i < count; i++)
+        sim.receiveSms("+420123456789", std::to_string(i) + " ON");
+
+    std::size_t received = 0;
+    auto ms = measure(sim, [&]()
+                      {
+        auto sms = modem.drainInbox();
+        received = sms.has_value() ? sms->size() : 0;
+        while (modem.poll(100))
+            ; });
+    printf("inbox drain   %5zu/%-5u %6llu ms  storage %zu\n", received, count, (unsigned long long)ms, sim.storage().size());
+}
+
+/**
+ * @brief one hour of the background refresh, the modem bytes of the round robin and of the scheduler
+ *
+ */
+void refresh()
+{
+    constexpr uint64_t hour{3600000000ull};
+    auto run = [](auto poll)
+    {
+        SimModem sim;
+        GSM modem(sim);
+        auto start = sim.getus();
+        auto bytes = sim.rxBytes() + sim.txBytes();
+        uint32_t requests = 0;
+        while (sim.getus() - start < hour)
+        {
+            auto [items, next] = poll(sim.getus() - start);
+            if (items && modem.telemetry(items).has_value())
+                requests++;
+            if (next > sim.getus() - start)
+                sim.advance(next - (sim.getus() - start));
+        }
+        return std::make_tuple(requests, sim.rxBytes() + sim.txBytes() - bytes);
+    };
+
+    // GSMTick: provider, signal and storage every 30 s
+    auto [rrRequests, rrBytes] = run([](uint64_t now)
+                                     { return std::make_tuple((uint8_t)(Telemetry::provider | Telemetry::signal | Telemetry::storage), (now / 30000000 + 1) * 30000000); });
+
+    // GSMTask items, GNSS streamed, the time samples are not counted in any of them
+    PollScheduler polls;
+    polls.add({Telemetry::signal, 60000, 2000, 4}, 0);
+    polls.add({Telemetry::registration, 60000, 2000, 5}, 0);
+    polls.add({Telemetry::storage, 300000, 5000, 2}, 0);
+    polls.add({Telemetry::provider, 600000, 10000, 1}, 0);
+    auto [psRequests, psBytes] = run([&polls](uint64_t now)
+                                     {
+        uint8_t items = 0;
+        for (auto id = polls.next(now, false); id.has_value(); id = polls.next(now, false))
+            items |= (uint8_t)id.value();
+        return std::make_tuple(items, polls.nextDueUs()); });
+
+    printf("refresh 1 h   round robin %4u req %7llu B  scheduler %4u req %7llu B  %.0f %%\n", rrRequests, (unsigned long long)rrBytes,
+           psRequests, (unsigned long long)psBytes, rrBytes ? psBytes * 100.0 / rrBytes : 0.0);
+}
+
+void recovery(const char *name, void (*fault)(SimModem &))
+{
+    SimModem sim;
+    GSM modem(sim);
+    modem.echoOff();
+
+    fault(sim);
+    auto report = modem.recover(true);
+    static const char *tiers[]{"none", "resync", "radio", "registration", "power cycle", "failed"};
+    printf("recovery      %-12s %-12s %6u ms\n", name, tiers[(int)report._tier], report._elapsedMs);
+}
+
+} // namespace
+
+int main()
+{
+    boot();
+    telemetry(1000, 0);
+    telemetry(1000, 200);
+    telemetry(1000, 0, true);
+    inbox(20);
+    refresh();
+    recovery("busy", [](SimModem &sim)
+             { sim.hang(3000); });
+    recovery("no network", [](SimModem &sim)
+             { sim.dropNetwork(2); });
+    recovery("hang", [](SimModem &sim)
+             { sim.hang(); });
+    return 0;
+}
@@ -0,0 +1,708 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   sim_modem.cpp
+/// @author Petr Vanek
+
+#include <cstdio>
+#include <ctime>
+#include <cctype>
+#include <algorithm>
+#include "sim_modem.h"
+
+namespace gsm {
+
+namespace {
+
+constexpr char C_CTRLZ{0x1a};
+constexpr char C_ESC{0x1b};
+constexpr uint64_t C_MS{1000};
+
+void appendHex(std::string &out, uint8_t value)
+{
+    static constexpr char hex[]{"0123456789ABCDEF"};
+    out += hex[value >> 4];
+    out += hex[value & 0x0f];
+}
+
+// SMS-DELIVER without the SMSC address, GSM 7 bit text, ascii characters as their septets
+std::string deliverPdu(std::string_view number, std::string_view stamp, std::string_view text)
+{
+    std::string rc;
+    appendHex(rc, 0x00);
+    appendHex(rc, 0x04);
+
+    bool international = !number.empty() && number.front() == '+';
+    if (international)
+        number.remove_prefix(1);
+    appendHex(rc, (uint8_t)number.size());
+    appendHex(rc, international ? 0x91 : 0x81);
+    for (std::size_t i = 0; i < number.size(); i += 2)
+    {
+        rc += (i + 1 < number.size()) ? number[i + 1] : 'F';
+        rc += number[i];
+    }
+
+    appendHex(rc, 0x00);
+    appendHex(rc, 0x00);
+
+    // "yy/MM/dd,hh:mm:ss+zz", swapped digits
+    for (std::size_t i = 0; i + 1 < stamp.size() && i < 18; i += 3)
+    {
+        rc += stamp[i + 1];
+        rc += stamp[i];
+    }
+    uint8_t zone = (uint8_t)(((stamp[19] - '0') << 4) | (stamp[18] - '0') | (stamp[17] == '-' ? 0x08 : 0x00));
+    appendHex(rc, zone);
+
+    appendHex(rc, (uint8_t)text.size());
+    std::vector<uint8_t> ud((text.size() * 7 + 7) / 8, 0);
+    for (std::size_t i = 0, bit = 0; i < text.size(); i++)
+    {
+        for (int b = 0; b < 7; b++, bit++)
+        {
+            if (text[i] & (1 << b))
+                ud[bit / 8] |= (uint8_t)(1 << (bit % 8));
+        }
+    }
+    for (auto x : ud)
+        appendHex(rc, x);
+    return rc;
+}
+
+std::string upper(std::string_view str)
+{
+    std::string rc(str);
+    std::transform(rc.begin(), rc.end(), rc.begin(), [](unsigned char c)
+                   { return (char)std::toupper(c); });
+    return rc;
+}
+
+bool startsWith(std::string_view str, std::string_view prefix)
+{
+    return str.substr(0, prefix.size()) == prefix;
+}
+
+std::string quoted(std::string_view str)
+{
+    std::string rc("\"");
+    rc += str;
+    rc += '"';
+    return rc;
+}
+
+} // namespace
+
+SimModem::SimModem() : SimModem(Profile{})
+{
+}
+
+SimModem::SimModem(const Profile &profile, bool powered) : _profile(profile)
+{
+    if (powered)
+    {
+        // already running, boot messages are gone
+        powerOn();
+        _out.clear();
+        _hangUntil = 0;
+        _stat = _profile._registration;
+        _registeredAt = 0;
+    }
+}
+
+bool SimModem::isReadable()
+{
+    return !_out.empty() && _out.front()._at <= _now;
+}
+
+std::size_t SimModem::read(char *buffer, std::size_t size, char delimiter)
+{
+    std::size_t cnt = 0;
+    while (cnt < size && isReadable())
+    {
+        auto &front = _out.front();
+        char c = front._data.front();
+        front._data.erase(0, 1);
+        if (front._data.empty())
+            _out.pop_front();
+
+        _rxBytes++;
+        if (_noisePpm)
+        {
+            // Park-Miller, the same sequence for the same seed
+            _seed = (uint32_t)(((uint64_t)_seed * 48271u) % 2147483647u);
+            if (_seed % 1000000u < _noisePpm)
+            {
+                // every other error is a lost byte
+                if (_seed & 1)
+                    continue;
+                c = (char)('!' + _seed % 90);
+            }
+        }
+
+        buffer[cnt++] = c;
+        if (c == delimiter)
+            break;
+    }
+    return cnt;
+}
+
+std::size_t SimModem::write(std::string_view data)
+{
+    _txBytes += data.size();
+    if (!_powered || hanging())
+        return data.size();
+
+    for (auto c : data)
+    {
+        if (_prompt)
+        {
+            if (c == C_CTRLZ || c == C_ESC)
+            {
+                _prompt = false;
+                if (c == C_CTRLZ)
+                    payload(_in);
+                _in.clear();
+                continue;
+            }
+            _in += c;
+            continue;
+        }
+
+        if (c == '\n')
+            continue;
+        if (c != '\r')
+        {
+            _in += c;
+            continue;
+        }
+
+        auto cmd = _in;
+        _in.clear();
+        if (_echo)
+            emit(cmd + "\r\n", _now);
+        command(cmd);
+    }
+    return data.size();
+}
+
+void SimModem::delay(uint16_t ms)
+{
+    advance(ms * C_MS);
+}
+
+uint64_t SimModem::getus()
+{
+    // every call costs a little, polling loops always make progress
+    advance(1);
+    return _now;
+}
+
+bool SimModem::waitReadable(uint32_t maxWait)
+{
+    if (isReadable())
+        return true;
+
+    auto until = _now + maxWait * C_MS;
+    if (!_out.empty())
+        until = std::min(until, std::max(_now, _out.front()._at));
+    advance(until - _now);
+    return isReadable();
+}
+
+void SimModem::hardwareInit()
+{
+}
+
+void SimModem::modemInit()
+{
+    // power key pulse toggles the modem, see SerialImpl::modemInit
+    advance(500 * C_MS);
+    if (_powered)
+    {
+        _powered = false;
+        _out.clear();
+        _in.clear();
+        _prompt = false;
+    }
+    else
+    {
+        powerOn();
+    }
+    advance(2500 * C_MS);
+}
+
+void SimModem::advance(uint64_t us)
+{
+    _now += us;
+    update();
+}
+
+void SimModem::inject(std::string_view data, uint32_t afterMs)
+{
+    line(data, _now + afterMs * C_MS);
+}
+
+void SimModem::receiveSms(std::string_view number, std::string_view text, uint32_t afterMs)
+{
+    Sms sms;
+    sms._number = number;
+    sms._text = text;
+    sms._stamp = clock(_now + afterMs * C_MS);
+    deliver(sms, _now + afterMs * C_MS);
+}
+
+void SimModem::ring(std::string_view number, uint32_t afterMs)
+{
+    auto at = _now + afterMs * C_MS;
+    line("RING", at);
+    if (_callerId)
+        line("+CLIP: " + quoted(number) + ",145,\"\",0,\"\",0", at);
+}
+
+void SimModem::hang(uint32_t durationMs)
+{
+    _hangUntil = durationMs ? _now + durationMs * C_MS : UINT64_MAX;
+    _in.clear();
+    _prompt = false;
+}
+
+void SimModem::dropNetwork(uint8_t stat, bool untilPowerCycle)
+{
+    _lost = untilPowerCycle;
+    _stat = stat;
+    _registeredAt = 0;
+    line("+CREG: " + std::to_string(stat), _now);
+}
+
+void SimModem::noise(uint32_t ppm, uint32_t seed)
+{
+    _noisePpm = ppm;
+    _seed = seed ? seed : 1;
+}
+
+void SimModem::emit(std::string_view data, uint64_t atUs)
+{
+    if (!_powered)
+        return;
+
+    // ordered by the release time, the same time keeps the order of emit
+    auto it = std::find_if(_out.begin(), _out.end(), [atUs](const Pending &p)
+                           { return p._at > atUs; });
+    _out.insert(it, Pending{atUs, std::string(data)});
+}
+
+void SimModem::line(std::string_view data, uint64_t atUs)
+{
+    std::string str("\r\n");
+    str += data;
+    str += "\r\n";
+    emit(str, atUs);
+}
+
+void SimModem::powerOn()
+{
+    // settings are lost, the SIM storage stays
+    _powered = true;
+    _echo = true;
+    _textMode = false;
+    _callerId = false;
+    _direct = false;
+    _smsHeader = false;
+    _radio = true;
+    _gnss = false;
+    _nmea = false;
+    _stat = 0;
+    _prompt = false;
+    _in.clear();
+    _busyUntil = 0;
+    _powerDownAt = 0;
+    _lost = false;
+
+    auto rdy = _now + _profile._bootMs * C_MS;
+    _hangUntil = rdy;
+    emit("\r\nRDY\r\n", rdy);
+    line("+CFUN: 1", rdy + 10 * C_MS);
+    if (_profile._simPresent)
+    {
+        line("+CPIN: READY", rdy + 20 * C_MS);
+        line("Call Ready", rdy + _profile._readyMs * C_MS);
+        line("SMS Ready", rdy + _profile._readyMs * C_MS);
+        search(rdy);
+    }
+    else
+    {
+        line("+CPIN: NOT INSERTED", rdy + 20 * C_MS);
+    }
+}
+
+void SimModem::search(uint64_t atUs)
+{
+    _stat = 2;
+    _registeredAt = atUs + _profile._registrationMs * C_MS;
+}
+
+void SimModem::update()
+{
+    if (_powerDownAt && _now >= _powerDownAt)
+    {
+        _powerDownAt = 0;
+        _powered = false;
+        _in.clear();
+        _prompt = false;
+    }
+
+    if (_registeredAt && _now >= _registeredAt)
+    {
+        _registeredAt = 0;
+        if (_radio && _powered && !_lost)
+            _stat = _profile._registration;
+    }
+
+    // one burst ahead, waitReadable wakes up for it
+    while (_nmea && _gnss && _powered && _nmeaNext <= _now + 1000 * C_MS)
+    {
+        if (!hanging())
+            emit(nmea(_nmeaNext), _nmeaNext);
+        _nmeaNext += 1000 * C_MS;
+    }
+}
+
+bool SimModem::hanging() const
+{
+    return _now < _hangUntil;
+}
+
+uint32_t SimModem::latency(std::string_view cmd) const
+{
+    uint32_t rc = _profile._defaultLatencyMs;
+    std::size_t longest = 0;
+    for (const auto &[prefix, ms] : _profile._latency)
+    {
+        if (prefix.size() > longest && startsWith(cmd, prefix))
+        {
+            longest = prefix.size();
+            rc = ms;
+        }
+    }
+    return rc;
+}
+
+std::string SimModem::clock(uint64_t atUs) const
+{
+    time_t t = (time_t)(_profile._epoch + (int64_t)(atUs / 1000000));
+    struct tm tmx;
+    gmtime_r(&t, &tmx);
+    char buff[32];
+    strftime(buff, sizeof(buff), "%y/%m/%d,%H:%M:%S+00", &tmx);
+    return buff;
+}
+
+std::string SimModem::nmea(uint64_t atUs) const
+{
+    auto sentence = [](std::string data)
+    {
+        uint8_t sum = 0;
+        for (auto c : data)
+            sum ^= (uint8_t)c;
+        char buff[8];
+        snprintf(buff, sizeof(buff), "*%02X\r\n", sum);
+        return "$" + data + buff;
+    };
+
+    // the same position as AT+CGNSINF, 50.087451 N 14.420671 E
+    auto tm = clock(atUs);
+    auto time = tm.substr(9, 2) + tm.substr(12, 2) + tm.substr(15, 2) + ".000";
+    auto date = tm.substr(6, 2) + tm.substr(3, 2) + tm.substr(0, 2);
+    return sentence("GPGGA," + time + ",5005.24706,N,01425.24026,E,1,8,0.9,235.0,M,45.0,M,,") +
+           sentence("GPGSA,A,3,01,03,08,11,14,17,22,28,,,,,1.2,0.9,0.8") +
+           sentence("GPRMC," + time + ",A,5005.24706,N,01425.24026,E,0.00,0.0," + date + ",,,A");
+}
+
+std::string SimModem::smsHeader(std::size_t index, bool list) const
+{
+    const auto &sms = _storage.at(index);
+    std::string rc(list ? "+CMGL: " + std::to_string(index) + "," : "+CMGR: ");
+    rc += sms._read ? "\"REC READ\"," : "\"REC UNREAD\",";
+    rc += quoted(sms._number) + ",\"\"," + quoted(sms._stamp);
+    if (_smsHeader)
+        rc += ",145," + std::to_string(sms._text.size());
+    return rc;
+}
+
+void SimModem::deliver(const Sms &sms, uint64_t atUs)
+{
+    if (_direct && _textMode)
+    {
+        // AT+CNMI=2,2 - not stored, AT+CSDH=1 adds the text length
+        auto header = "+CMT: " + quoted(sms._number) + ",\"\"," + quoted(sms._stamp);
+        if (_smsHeader)
+            header += ",145,4,0,0,\"+420603052000\",145," + std::to_string(sms._text.size());
+        line(header, atUs);
+        emit(sms._text + "\r\n", atUs);
+        return;
+    }
+
+    if (_direct)
+    {
+        // PDU mode, the length excludes the SMSC octet
+        auto pdu = deliverPdu(sms._number, sms._stamp, sms._text);
+        line("+CMT: ," + std::to_string(pdu.size() / 2 - 1), atUs);
+        emit(pdu + "\r\n", atUs);
+        return;
+    }
+
+    std::size_t index = 1;
+    while (_storage.count(index))
+        index++;
+    _storage[index] = sms;
+    line("+CMTI: \"SM\"," + std::to_string(index), atUs);
+}
+
+void SimModem::payload(std::string_view data)
+{
+    Sms sms;
+    sms._number = _smsNumber.empty() ? std::string("PDU") : _smsNumber;
+    sms._text = data;
+    sms._stamp = clock(_now);
+    _sent.push_back(sms);
+
+    auto at = std::max(_now, _busyUntil) + latency("AT+CMGS") * C_MS;
+    _busyUntil = at;
+    line("+CMGS: " + std::to_string(_sent.size() % 256), at);
+    line("OK", at);
+}
+
+void SimModem::command(std::string_view cmd)
+{
+    _commands.emplace_back(cmd);
+    update();
+
+    auto ucmd = upper(cmd);
+    if (!startsWith(ucmd, "AT"))
+        return;
+
+    if (ucmd == "AT+CPOWD=1")
+    {
+        // NORMAL POWER DOWN instead of OK, off a moment later
+        auto at = std::max(_now, _busyUntil) + latency(ucmd) * C_MS;
+        line("NORMAL POWER DOWN", at);
+        _busyUntil = at;
+        _powerDownAt = at + 1000 * C_MS;
+        return;
+    }
+
+    // AT+CSQ;+CREG? -> AT+CSQ, AT+CREG?, answered after the previous command
+    std::string out;
+    uint64_t at = std::max(_now, _busyUntil);
+    bool ok = true;
+    bool quotes = false;
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i <= cmd.size() && ok; i++)
+    {
+        if (i < cmd.size() && cmd[i] == '"')
+            quotes = !quotes;
+        if (i < cmd.size() && (cmd[i] != ';' || quotes))
+            continue;
+
+        auto single = std::string(begin ? "AT" : "") + std::string(cmd.substr(begin, i - begin));
+        begin = i + 1;
+
+        ok = part(single, out, at);
+        if (_prompt)
+        {
+            // AT+CMGS waits for the payload
+            _busyUntil = at;
+            emit(out + "\r\n> ", at);
+            return;
+        }
+    }
+
+    out += ok ? "\r\nOK\r\n" : "\r\nERROR\r\n";
+    _busyUntil = at;
+    emit(out, at);
+}
+
+bool SimModem::part(std::string_view cmd, std::string &out, uint64_t &atUs)
+{
+    auto add = [&out](std::string_view str)
+    {
+        out += "\r\n";
+        out += str;
+        out += "\r\n";
+    };
+    auto value = [cmd](std::string_view prefix)
+    {
+        return cmd.substr(prefix.size());
+    };
+
+    auto ucmd = upper(cmd);
+    atUs += latency(ucmd) * C_MS;
+
+    bool rc = true;
+    if (ucmd == "AT")
+    {
+    }
+    else if (ucmd == "ATE0" || ucmd == "ATE1")
+    {
+        _echo = ucmd.back() == '1';
+    }
+    else if (ucmd == "ATH" || ucmd == "ATA")
+    {
+    }
+    else if (ucmd == "AT+CPIN?")
+    {
+        if (!_profile._simPresent)
+        {
+            add("+CME ERROR: 10");
+            rc = false;
+        }
+        else
+            add("+CPIN: READY");
+    }
+    else if (ucmd == "AT+CCID")
+    {
+        rc = _profile._simPresent;
+        if (rc)
+            add(_profile._iccid);
+    }
+    else if (startsWith(ucmd, "AT+CLIP="))
+    {
+        _callerId = value("AT+CLIP=") == "1";
+    }
+    else if (startsWith(ucmd, "AT+CMGF="))
+    {
+        _textMode = value("AT+CMGF=") == "1";
+    }
+    else if (startsWith(ucmd, "AT+CSDH="))
+    {
+        _smsHeader = value("AT+CSDH=") == "1";
+    }
+    else if (startsWith(ucmd, "AT+CGNSPWR="))
+    {
+        _gnss = value("AT+CGNSPWR=") == "1";
+    }
+    else if (startsWith(ucmd, "AT+CGNSTST="))
+    {
+        _nmea = value("AT+CGNSTST=") == "1";
+        _nmeaNext = atUs + 1000 * C_MS - atUs % (1000 * C_MS);
+    }
+    else if (startsWith(ucmd, "AT+CNMI="))
+    {
+        // AT+CNMI=2,2,0,0,0 - direct delivery
+        auto mt = value("AT+CNMI=");
+        _direct = mt.size() > 2 && mt[2] == '2';
+    }
+    else if (ucmd == "AT+CSQ")
+    {
+        add("+CSQ: " + std::to_string(_radio ? _profile._rssi : 99) + ",0");
+    }
+    else if (ucmd == "AT+CREG?")
+    {
+        add("+CREG: 0," + std::to_string(_stat));
+    }
+    else if (ucmd == "AT+COPS?")
+    {
+        if (_stat == 1 || _stat == 5)
+            add("+COPS: 0,0," + quoted(_profile._operator));
+        else
+            add("+COPS: 0");
+    }
+    else if (ucmd == "AT+COPS=0")
+    {
+        if (_radio)
+            search(atUs);
+        rc = _radio;
+    }
+    else if (ucmd == "AT+CCLK?")
+    {
+        add("+CCLK: " + quoted(clock(atUs)));
+    }
+    else if (startsWith(ucmd, "AT+CFUN="))
+    {
+        _radio = value("AT+CFUN=") != "0";
+        if (_radio)
+        {
+            add("+CFUN: 1");
+            search(atUs);
+        }
+        else
+        {
+            _stat = 0;
+            _registeredAt = 0;
+        }
+    }
+    else if (ucmd == "AT+CGNSINF")
+    {
+        if (_gnss)
+        {
+            auto tm = clock(atUs);
+            // yy/MM/dd,hh:mm:ss -> 20yyMMddhhmmss.000
+            std::string utc = "20" + tm.substr(0, 2) + tm.substr(3, 2) + tm.substr(6, 2) +
+                              tm.substr(9, 2) + tm.substr(12, 2) + tm.substr(15, 2) + ".000";
+            add("+CGNSINF: 1,1," + utc + ",50.087451,14.420671,235.0,0.00,0.0,1,,0.9,1.2,0.8,,11,8,,,42,,");
+        }
+        else
+            add("+CGNSINF: 0,,,,,,,,,,,,,,,,,,,,");
+    }
+    else if (ucmd == "AT+CPMS?")
+    {
+        auto n = std::to_string(_storage.size());
+        add("+CPMS: \"SM\"," + n + ",30,\"SM\"," + n + ",30,\"SM\"," + n + ",30");
+    }
+    else if (startsWith(ucmd, "AT+CMGR="))
+    {
+        std::size_t index = std::strtoul(std::string(value("AT+CMGR=")).c_str(), nullptr, 10);
+        if (_storage.count(index))
+        {
+            add(smsHeader(index, false));
+            out += _storage[index]._text + "\r\n";
+            _storage[index]._read = true;
+        }
+    }
+    else if (startsWith(ucmd, "AT+CMGL="))
+    {
+        bool all = value("AT+CMGL=") == "\"ALL\"";
+        for (auto &[index, sms] : _storage)
+        {
+            if (sms._read && !all)
+                continue;
+            add(smsHeader(index, true));
+            out += sms._text + "\r\n";
+            sms._read = true;
+        }
+    }
+    else if (startsWith(ucmd, "AT+CMGDA="))
+    {
+        bool all = value("AT+CMGDA=") == "\"DEL ALL\"";
+        for (auto it = _storage.begin(); it != _storage.end();)
+            it = (all || it->second._read) ? _storage.erase(it) : std::next(it);
+    }
+    else if (startsWith(ucmd, "AT+CMGD="))
+    {
+        // AT+CMGD=<index>[,<flag>], flag 4 - all
+        auto params = value("AT+CMGD=");
+        if (params.find(",4") != std::string_view::npos)
+            _storage.clear();
+        else
+            _storage.erase(std::strtoul(std::string(params).c_str(), nullptr, 10));
+    }
+    else if (startsWith(ucmd, "AT+CMGS="))
+    {
+        // text mode "number", PDU mode length
+        auto param = value("AT+CMGS=");
+        _smsNumber = (param.size() > 1 && param.front() == '"') ? std::string(param.substr(1, param.size() - 2)) : std::string();
+        atUs -= latency(ucmd) * C_MS;
+        atUs += _profile._defaultLatencyMs * C_MS;
+        _prompt = true;
+    }
+    else
+    {
+        rc = false;
+    }
+
+    return rc;
+}
+
+} // namespace gsm
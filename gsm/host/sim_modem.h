@@ -0,0 +1,196 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   sim_modem.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <map>
+#include "src-gsm/serial_modem_intf.h"
+
+namespace gsm {
+
+/**
+ * @brief host side SIM800 / SIM868 emulation of the AT dialect used by gsm::GSM.
+ * Everything runs on a virtual clock - delay() and waitReadable() move the time,
+ * so the driver can be measured deterministically without the board.
+ *
+ */
+class SimModem : public ISerialModem
+{
+public:
+    /**
+     * @brief stored message
+     *
+     */
+    struct Sms
+    {
+        std::string _number;
+        std::string _text;
+        std::string _stamp;                     ///< "yy/MM/dd,hh:mm:ss+zz"
+        bool _read{false};
+    };
+
+    /**
+     * @brief behaviour of the emulated modem
+     *
+     */
+    struct Profile
+    {
+        uint32_t _bootMs{3000};                 ///< power key to RDY
+        uint32_t _readyMs{2000};                ///< RDY to SMS Ready
+        uint32_t _registrationMs{4000};         ///< radio on to the network registration
+        uint32_t _defaultLatencyMs{20};         ///< command to the response
+        std::map<std::string, uint32_t> _latency{
+            {"AT+CMGS", 3000},
+            {"AT+COPS=", 500},
+            {"AT+CFUN", 1500},
+            {"AT+CMGL", 200},
+        };                                      ///< per command prefix, the longest one wins
+        bool _simPresent{true};
+        uint8_t _registration{1};               ///< +CREG stat once registered, 1 home, 5 roaming
+        uint8_t _rssi{18};
+        std::string _operator{"T-Mobile CZ"};
+        std::string _iccid{"89420030123456789012"};
+        int64_t _epoch{1677918143};             ///< UTC of the virtual time 0, 2023-03-04 08:22:23
+    };
+
+    SimModem();
+    explicit SimModem(const Profile &profile, bool powered = true);
+
+    // ISerialModem
+    bool isReadable() override;
+    std::size_t read(char *buffer, std::size_t size, char delimiter) override;
+    std::size_t write(std::string_view data) override;
+    void delay(uint16_t ms) override;
+    uint64_t getus() override;
+    bool waitReadable(uint32_t maxWait) override;
+    void hardwareInit() override;
+    void modemInit() override;
+
+    /**
+     * @brief moves the virtual clock
+     *
+     * @param us
+     */
+    void advance(uint64_t us);
+
+    /**
+     * @brief unsolicited line, e.g. "RING", sent after the delay
+     *
+     * @param line - without CRLF
+     * @param afterMs
+     */
+    void inject(std::string_view line, uint32_t afterMs = 0);
+
+    /**
+     * @brief incoming SMS, stored and announced by +CMTI or delivered by +CMT (AT+CNMI=2,2),
+     * the text may contain line breaks
+     *
+     * @param number
+     * @param text
+     * @param afterMs
+     */
+    void receiveSms(std::string_view number, std::string_view text, uint32_t afterMs = 0);
+
+    /**
+     * @brief incoming call, RING + +CLIP if enabled
+     *
+     * @param number
+     * @param afterMs
+     */
+    void ring(std::string_view number, uint32_t afterMs = 0);
+
+    /**
+     * @brief the modem stops responding
+     *
+     * @param durationMs - 0 until the power cycle
+     */
+    void hang(uint32_t durationMs = 0);
+
+    /**
+     * @brief network lost, registered again after the radio restart or AT+COPS=0
+     *
+     * @param stat - +CREG stat, e.g. 2 searching, 3 denied
+     * @param untilPowerCycle - the radio restart and AT+COPS=0 do not help
+     */
+    void dropNetwork(uint8_t stat = 2, bool untilPowerCycle = false);
+
+    /**
+     * @brief corrupts or drops received characters
+     *
+     * @param ppm - error rate per received byte [1/1000000]
+     * @param seed - deterministic sequence
+     */
+    void noise(uint32_t ppm, uint32_t seed = 1);
+
+    const std::vector<std::string> &commands() const { return _commands; }  ///< received commands
+    const std::vector<Sms> &sent() const { return _sent; }                  ///< AT+CMGS messages, PDU as hex
+    const std::map<std::size_t, Sms> &storage() const { return _storage; }  ///< SIM storage by index
+    bool powered() const { return _powered; }
+    uint64_t rxBytes() const { return _rxBytes; }                           ///< bytes sent to the driver
+    uint64_t txBytes() const { return _txBytes; }                           ///< bytes received from the driver
+
+private:
+    struct Pending
+    {
+        uint64_t _at;           ///< release time [us]
+        std::string _data;
+    };
+
+    void emit(std::string_view data, uint64_t atUs);
+    void line(std::string_view data, uint64_t atUs);
+    void powerOn();
+    void search(uint64_t atUs);
+    void update();
+    void command(std::string_view cmd);
+    void payload(std::string_view data);
+    bool part(std::string_view cmd, std::string &out, uint64_t &atUs);
+    uint32_t latency(std::string_view cmd) const;
+    bool hanging() const;
+    std::string clock(uint64_t atUs) const;
+    std::string nmea(uint64_t atUs) const;
+    std::string smsHeader(std::size_t index, bool list) const;
+    void deliver(const Sms &sms, uint64_t atUs);
+
+    Profile _profile;
+    uint64_t _now{0};                       ///< virtual time [us]
+    std::deque<Pending> _out;               ///< modem -> driver, ordered by time
+    std::string _in;                        ///< driver -> modem, not finished command
+    std::string _smsNumber;                 ///< AT+CMGS recipient, waiting for the payload
+    bool _prompt{false};                    ///< "> " sent, payload until Ctrl+Z
+    uint64_t _busyUntil{0};                 ///< the previous command is answered [us], commands are processed in order
+
+    bool _powered{false};
+    bool _echo{true};
+    bool _textMode{false};
+    bool _callerId{false};
+    bool _direct{false};
+    bool _smsHeader{false};                 ///< AT+CSDH=1
+    bool _radio{true};
+    bool _gnss{false};
+    bool _nmea{false};                      ///< AT+CGNSTST=1
+    uint64_t _nmeaNext{0};                  ///< the next NMEA burst [us]
+    uint8_t _stat{0};                       ///< current +CREG stat
+    uint64_t _registeredAt{0};              ///< pending registration [us], 0 - none
+    bool _lost{false};                      ///< no registration until the power cycle
+    uint64_t _hangUntil{0};                 ///< UINT64_MAX until the power cycle
+    uint64_t _powerDownAt{0};               ///< AT+CPOWD=1 switches the modem off [us], 0 - none
+    uint32_t _noisePpm{0};
+    uint32_t _seed{1};
+
+    std::map<std::size_t, Sms> _storage;
+    std::vector<Sms> _sent;
+    std::vector<std::string> _commands;
+    uint64_t _rxBytes{0};
+    uint64_t _txBytes{0};
+};
+
+} // namespace gsm
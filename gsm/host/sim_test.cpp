@@ -0,0 +1,310 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   sim_test.cpp
+/// @author Petr Vanek
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "sim_modem.h"
+#include "src-gsm/gsm.h"
+#include "src-gsm/sms_outbox.h"
+#include "src-utils/time_discipline.h"
+
+using namespace gsm;
+
+namespace {
+
+uint32_t failures = 0;
+
+#define CHECK(cond)                                                      \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                  \
+        }                                                                \
+    } while (false)
+
+// the events of the modem, the direct SMS collected
+std::vector<SmsMessage> events(GSM &modem, uint32_t rounds = 40)
+{
+    std::vector<SmsMessage> rc;
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        modem.poll(50);
+        if (modem.checkStatus(50) == ResponseStatus::directsms && modem.incomingSMS().has_value())
+            rc.push_back(modem.incomingSMS().value());
+    }
+    return rc;
+}
+
+void boot()
+{
+    SimModem sim(SimModem::Profile{}, false);
+    GSM modem(sim);
+
+    CHECK(modem.init(true));
+    CHECK(sim.powered());
+    CHECK(modem.simSetup(true).has_value());
+    CHECK(modem.waitRegistered(60000) == 1);
+    CHECK(modem.isResponsive());
+}
+
+void telemetry()
+{
+    SimModem sim;
+    GSM modem(sim);
+    modem.echoOff();
+
+    for (int i = 0; i < 10; i++)
+    {
+        auto tm = modem.telemetry(Telemetry::all);
+        CHECK(tm.has_value());
+        if (!tm.has_value())
+            break;
+        CHECK(tm->_signal == 18);
+        CHECK(tm->_registration == 1);
+        CHECK(tm->_operator == "T-Mobile CZ");
+        CHECK(tm->_rtc.has_value() && tm->_rtc->year == 2023 && tm->_rtc->month == 3);
+        CHECK(tm->_storage.has_value() && std::get<0>(tm->_storage.value()) == 0);
+        // GNSS is off, its error does not lose the other items
+        CHECK(!tm->_gnss.has_value());
+    }
+}
+
+void drain()
+{
+    for (bool header : {false, true})
+    {
+        SimModem sim;
+        GSM modem(sim);
+        modem.echoOff();
+        if (header)
+            modem.showSMSHeader(true);
+
+        // the texts look like the result codes and the URC
+        const std::vector<std::string> texts{"ok", "OUT1 ON", "OK", "RING\nOK\r\nsecond", "error"};
+        for (const auto &t : texts)
+            sim.receiveSms("+420123456789", t);
+        for (int i = 0; i < 40; i++)
+            sim.receiveSms("+420123456789", "bulk message " + std::to_string(i));
+        while (modem.poll(10))
+            ;
+        while (modem.checkStatus(10) != ResponseStatus::unknown)
+            ;
+
+        // read before, e.g. listed by a drain that failed midway
+        CHECK(modem.readSMS(std::next(sim.storage().begin())->first).has_value());
+
+        auto sms = modem.drainInbox();
+        while (modem.poll(100))
+            ;
+        CHECK(sms.has_value() && sms->size() == texts.size() + 40);
+        if (!sms.has_value() || sms->size() < texts.size())
+            continue;
+        CHECK(std::get<0>((*sms)[0]) == "ok");
+        CHECK(std::get<0>((*sms)[2]) == "OK");
+        CHECK(std::get<0>((*sms)[3]) == "RING\nOK\nsecond");
+        CHECK(std::get<1>((*sms)[1]) == "+420123456789");
+        CHECK(sim.storage().empty());
+        // the response after the drain belongs to its command
+        CHECK(modem.qualitySignal() == 18);
+    }
+}
+
+void direct()
+{
+    SimModem sim;
+    GSM modem(sim);
+    modem.echoOff();
+    CHECK(modem.directSMS(true));
+
+    sim.receiveSms("+420123456789", "OUT1 ON\nOK\n\nSTATE", 10);
+    auto sms = events(modem);
+    CHECK(sms.size() == 1 && std::get<0>(sms[0]) == "OUT1 ON\nOK\n\nSTATE");
+
+    // +CMT in the PDU mode during a concatenated SMS
+    SmsOutbox outbox(modem);
+    CHECK(outbox.send("+420111", std::string(200, 'x')));
+    for (int i = 0; i < 3; i++)
+    {
+        outbox.poll(sim.getus());
+        modem.poll(100);
+    }
+    sim.receiveSms("+420123456789", "during pdu");
+    std::vector<SmsMessage> pdu;
+    for (int i = 0; i < 200; i++)
+    {
+        outbox.poll(sim.getus());
+        auto more = events(modem, 1);
+        pdu.insert(pdu.end(), more.begin(), more.end());
+    }
+    CHECK(outbox.sent() == 1);
+    CHECK(sim.sent().size() == 2);
+    CHECK(pdu.size() == 1 && std::get<0>(pdu[0]) == "during pdu" && std::get<1>(pdu[0]) == "+420123456789");
+    CHECK(modem.smsErrors() == 0);
+    CHECK(sim.storage().empty());
+}
+
+void timeout()
+{
+    // the reply comes after the deadline, the next commands get their own response
+    SimModem::Profile profile;
+    profile._latency["AT+CSQ"] = 23000;
+    SimModem sim(profile);
+    GSM modem(sim);
+    modem.echoOff();
+
+    CHECK(!modem.qualitySignal().has_value());
+    CHECK(modem.getOperator() == "T-Mobile CZ");
+    CHECK(modem.isRegistered() == 1);
+    CHECK(modem.isResponsive());
+
+    // synchronous call inside the callback fails instead of the recursion
+    bool called = false;
+    std::optional<uint8_t> inner{0};
+    CHECK(modem.getOperator([&](std::optional<std::string> op)
+                            {
+        called = op.has_value();
+        inner = modem.qualitySignal(); }));
+    while (modem.poll(100))
+        ;
+    CHECK(called);
+    CHECK(!inner.has_value());
+    CHECK(!modem.isBusy());
+}
+
+void deadline()
+{
+    // the learned deadline and the resync AT, a hung modem fails within seconds instead of the static 20 s
+    SimModem sim;
+    GSM modem(sim);
+    modem.echoOff();
+
+    for (int i = 0; i < 5; i++)
+    {
+        CHECK(modem.qualitySignal() == 18);
+        CHECK(modem.telemetry(Telemetry::all).has_value());
+    }
+
+    sim.hang();
+    for (bool call : {false, true})
+    {
+        auto t = sim.getus();
+        CHECK(call ? !modem.telemetry(Telemetry::all).has_value() : !modem.qualitySignal().has_value());
+        auto ms = (sim.getus() - t) / 1000;
+        CHECK(ms < 6000);
+    }
+}
+
+void recovery()
+{
+    struct Case
+    {
+        void (*_fault)(SimModem &);
+        RecoveryTier _tier;
+        uint32_t _maxMs;
+    };
+    // the power cycle is one toggle on, the running modem is switched off by AT+CPOWD=1
+    const Case cases[]{
+        {[](SimModem &sim)
+         { sim.hang(3000); },
+         RecoveryTier::resync, 5000},
+        {[](SimModem &sim)
+         { sim.dropNetwork(2); },
+         RecoveryTier::radio, 10000},
+        {[](SimModem &sim)
+         { sim.hang(); },
+         RecoveryTier::powerCycle, 20000},
+        {[](SimModem &sim)
+         { sim.dropNetwork(3, true); },
+         RecoveryTier::powerCycle, 75000},
+    };
+
+    for (const auto &c : cases)
+    {
+        SimModem sim;
+        GSM modem(sim);
+        modem.echoOff();
+        c._fault(sim);
+        auto report = modem.recover(true);
+        CHECK(report._tier == c._tier);
+        CHECK(sim.powered());
+        CHECK(report._elapsedMs < c._maxMs);
+        // the power cycle is followed by the network search
+        CHECK(modem.waitRegistered(60000) == 1);
+    }
+}
+
+void discipline()
+{
+    // the local clock is 50 ppm fast, AT+CCLK? whole seconds, a day of samples
+    constexpr int64_t epochUs{1677918143000000ll};
+    auto local = [](int64_t trueUs)
+    { return (uint64_t)(trueUs + trueUs / 20000); };
+
+    TimeDiscipline clock;
+    int64_t trueUs = 1234567;
+    int64_t worstUs = 0;
+    while (trueUs < 86400000000ll)
+    {
+        auto utc = (epochUs + trueUs) / 1000000 * 1000000;
+        clock.sample(utc, local(trueUs), 1000000);
+        trueUs += clock.pollIntervalMs() * 1000ll;
+        if (trueUs > 7200000000ll)
+            worstUs = std::max<int64_t>(worstUs, llabs(clock.utcUs(local(trueUs)) - (epochUs + trueUs)));
+    }
+
+    CHECK(clock.isValid());
+    CHECK(clock.steps() == 1);
+    // the correction of the fast clock, the error between the samples after two hours
+    CHECK(llabs(clock.driftPpb() + 50000) < 5000);
+    CHECK(worstUs < 200000);
+    CHECK(clock.pollIntervalMs() >= 480000);
+}
+
+struct Test
+{
+    const char *_name;
+    void (*_run)();
+};
+
+constexpr Test C_TESTS[]{
+    {"boot", boot},
+    {"telemetry", telemetry},
+    {"drain", drain},
+    {"direct", direct},
+    {"timeout", timeout},
+    {"deadline", deadline},
+    {"recovery", recovery},
+    {"discipline", discipline},
+};
+
+} // namespace
+
+/**
+ * @brief pass / fail checks of the driver against the simulator, run by ctest
+ *
+ * @param argc
+ * @param argv - test name, all if missing
+ * @return int - 0 passed
+ */
+int main(int argc, char **argv)
+{
+    bool found = false;
+    for (const auto &t : C_TESTS)
+    {
+        if (argc > 1 && strcmp(argv[1], t._name))
+            continue;
+        found = true;
+        auto before = failures;
+        t._run();
+        printf("%-12s %s\n", t._name, failures == before ? "passed" : "FAILED");
+    }
+    return (found && !failures) ? 0 : 1;
+}
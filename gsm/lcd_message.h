@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <string>
+#include "message_bus.h"
 
 
 using namespace std::literals;
@@ -26,7 +27,9 @@ enum class LCDMessageType
     number,             ///< print text as log
     gsmErrorModem,      ///< gsm error 
     backlon,            ///< back light on
-    backloff            ///< back light off
+    backloff,           ///< back light off
+    telemetry,          ///< operator and signal, _text is Topic::telemetry
+    outputs             ///< _value real pin mask of the outputs, Topic::outputState
 };
 
 
@@ -37,6 +40,26 @@ enum class LCDMessageType
 struct LCDMessage
 {
     LCDMessageType  _messageType{LCDMessageType::status};
-    char            _message[12];
+    BusRef          _text;          ///< MessageBus buffer, released by the LCD task
     int32_t         _value{0};
-};
\ No newline at end of file
+};
+
+/**
+ * @brief Topic::displayLine, the text is printed
+ *
+ */
+struct DisplayLine
+{
+    LCDMessageType  _messageType{LCDMessageType::status};
+    int32_t         _value{0};
+};
+
+/**
+ * @brief Topic::telemetry, the text is the operator name
+ *
+ */
+struct TelemetryEvent
+{
+    int16_t         _signal{-1};        ///< rssi, -1 - not read
+    int16_t         _registration{-1};  ///< AT+CREG stat, -1 - not read
+};
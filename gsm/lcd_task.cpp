@@ -18,23 +18,22 @@
 #include "src-lcd5110/generated/modeseven.h"
 #include "src-lcd5110/generated/topaz.h"
 #include "literals.h"
+#include "application.h"
 
 LCDTask::LCDTask()
 {
-    _queueDisplay = xQueueCreate(5, sizeof(LCDMessage));
 }
 
 LCDTask::~LCDTask()
 {
     done();
-    if (_queueDisplay)
-        vQueueDelete(_queueDisplay);
 }
 
 void LCDTask::loop()
 {
     // lcd initialization
     uint8_t rowposition = 0;
+    auto bus = Application::getInstance()->getBus();
     Lcd5110 lcd(LCD_SPI, LCD_RST_PIN, LCD_CE_PIN, LCD_DC_PIN, LCD_DIN_PIN, LCD_CLK_PIN, LCD_LIGHT_PIN);
 
     auto signal = [&lcd](int32_t value)
@@ -62,9 +61,9 @@ void LCDTask::loop()
     while (true)
     { // Loop forever
         LCDMessage msg;
-        auto res = xQueueReceive(_queueDisplay, (void *)&msg, (TickType_t)50 / portTICK_PERIOD_MS);
-        if (res == pdTRUE)
+        if (_lanes.receive(msg, (TickType_t)50 / portTICK_PERIOD_MS))
         {
+            auto text = bus->text(msg._text).data();
             switch (msg._messageType)
             {
 
@@ -84,14 +83,21 @@ void LCDTask::loop()
             case LCDMessageType::idcaller:
                 lcd.withSize(1);
                 lcd.withFont(&topaz::fnt[0][0], topaz::glypHeight, topaz::glypWidth, topaz::firstChar, topaz::glyps);
-                lcd.at(0, 30).print(msg._message);
+                lcd.at(0, 30).print(text);
+                lcd.refresh();
+                break;
+
+            case LCDMessageType::outputs:
+                lcd.withSize(1);
+                lcd.withFont(&topaz::fnt[0][0], topaz::glypHeight, topaz::glypWidth, topaz::firstChar, topaz::glyps);
+                lcd.at(0, 30).print((literals::output + OutputTask::outputsToString((uint32_t)msg._value)).c_str());
                 lcd.refresh();
                 break;
 
             case LCDMessageType::provider:
                 lcd.withSize(1);
                 lcd.withFont(&topaz::fnt[0][0], topaz::glypHeight, topaz::glypWidth, topaz::firstChar, topaz::glyps);
-                lcd.at(0, 0).print(msg._message);
+                lcd.at(0, 0).print(text);
                 lcd.refresh();
                 break;
 
@@ -100,17 +106,32 @@ void LCDTask::loop()
                 lcd.refresh();
                 break;
 
+            case LCDMessageType::telemetry:
+                if (auto tm = bus->get<TelemetryEvent>(msg._text))
+                {
+                    if (*text)
+                    {
+                        lcd.withSize(1);
+                        lcd.withFont(&topaz::fnt[0][0], topaz::glypHeight, topaz::glypWidth, topaz::firstChar, topaz::glyps);
+                        lcd.at(0, 0).print(text);
+                    }
+                    if (tm->_signal >= 0)
+                        signal(tm->_signal);
+                    lcd.refresh();
+                }
+                break;
+
             case LCDMessageType::date:
                 lcd.withSize(1);
                 lcd.withFont(&topaz::fnt[0][0], topaz::glypHeight, topaz::glypWidth, topaz::firstChar, topaz::glyps);
-                lcd.at(0, 10).print(msg._message);
+                lcd.at(0, 10).print(text);
                 lcd.refresh();
                 break;
 
             case LCDMessageType::time:
                 lcd.withSize(1);
                 lcd.withFont(&topaz::fnt[0][0], topaz::glypHeight, topaz::glypWidth, topaz::firstChar, topaz::glyps);
-                lcd.at(0, 20).print(msg._message);
+                lcd.at(0, 20).print(text);
                 lcd.refresh();
                 break;
 
@@ -154,12 +175,13 @@ void LCDTask::loop()
                 }
 
                 lcd.at(0, 10 + (rowposition * 10));
-                lcd.print(msg._message);
+                lcd.print(text);
                 lcd.refresh();
                 rowposition++;
 
                 break;
             }
+            bus->release(msg._text);
         }
     }
 }
@@ -169,10 +191,63 @@ bool LCDTask::init(const char *name, UBaseType_t priority, const configSTACK_DEP
     return RPTask::init(name, priority, stackDepth);
 }
 
-void LCDTask::message(const LCDMessage &msg, bool isr)
+bool LCDTask::message(const LCDMessage &msg, bool isr)
+{
+    bool rc = false;
+    std::optional<LCDMessage> replaced;
+    switch (msg._messageType)
+    {
+    case LCDMessageType::signal:
+    case LCDMessageType::provider:
+    case LCDMessageType::idcaller:
+    case LCDMessageType::date:
+    case LCDMessageType::time:
+    case LCDMessageType::telemetry:
+    case LCDMessageType::outputs:
+        // the latest value wins
+        rc = _lanes.postView(msg, (uint32_t)msg._messageType, isr, &replaced);
+        break;
+
+    default:
+        rc = _lanes.post(msg, isr);
+        break;
+    }
+
+    if (replaced.has_value())
+        Application::getInstance()->getBus()->release(replaced->_text, isr);
+    return rc;
+}
+
+bool LCDTask::onBus(void *context, Topic topic, BusRef ref, bool isr)
 {
-    if (_queueDisplay)
+    auto self = static_cast<LCDTask *>(context);
+    LCDMessage msg;
+    msg._text = ref;
+    if (topic == Topic::telemetry)
     {
-        (isr) ? xQueueSendToBackFromISR(_queueDisplay, (void *)&msg, 0) : xQueueSendToBack(_queueDisplay, (void *)&msg, 0);
+        msg._messageType = LCDMessageType::telemetry;
+        return self->message(msg, isr);
     }
+
+    if (topic == Topic::outputState)
+    {
+        // the mask is enough, the buffer is not kept
+        auto state = Application::getInstance()->getBus()->get<OutputState>(ref);
+        if (state)
+        {
+            msg._messageType = LCDMessageType::outputs;
+            msg._value = (int32_t)state->_mask;
+            msg._text = BusRef{};
+            self->message(msg, isr);
+        }
+        return false;
+    }
+
+    auto line = Application::getInstance()->getBus()->get<DisplayLine>(ref);
+    if (!line)
+        return false;
+
+    msg._messageType = line->_messageType;
+    msg._value = line->_value;
+    return self->message(msg, isr);
 }
\ No newline at end of file
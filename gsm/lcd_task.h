@@ -16,6 +16,7 @@
 #include "src-lcd5110/lcd5110.h"
 #include "hardware.h"
 #include "lcd_message.h"
+#include "src-utils/message_lanes.h"
 
 /**
  * @brief Task for Nokia 5110 display
@@ -30,11 +31,39 @@ public:
 
 	virtual bool init(const char *name, UBaseType_t priority = tskIDLE_PRIORITY, const configSTACK_DEPTH_TYPE stackDepth = configMINIMAL_STACK_SIZE) override;
 
-	void message(const LCDMessage &msg, bool isr);
+	/**
+	 * @brief screen sequences (status, number, init, backlight) in the control lane,
+	 * values shown at a fixed place (signal, operator, time ...) are coalesced
+	 * 
+	 * @param msg 
+	 * @param isr 
+	 * @return true - queued
+	 */
+	bool message(const LCDMessage &msg, bool isr);
+
+	/**
+	 * @brief MessageBus subscriber, Topic::displayLine, Topic::telemetry and Topic::outputState
+	 * 
+	 * @param context - LCDTask
+	 * @param topic 
+	 * @param ref - released after the message is shown
+	 * @param isr 
+	 * @return true - queued
+	 */
+	static bool onBus(void *context, Topic topic, BusRef ref, bool isr);
+
+	using Lanes = MessageLanes<LCDMessage, 8, 7>;
+
+	/**
+	 * @brief request queue, overflow statistics
+	 *
+	 * @return const Lanes&
+	 */
+	const Lanes &lanes() const { return _lanes; }
 
 protected:
 	void loop() override;
 
 private:
-	QueueHandle_t _queueDisplay;
+	Lanes _lanes;		///< requests
 };
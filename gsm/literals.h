@@ -69,10 +69,16 @@ public:
     static constexpr const char *tsk_led{"LEDTSK"};
     static constexpr const char *tsk_gsm{"GSMTSK"};
     static constexpr const char *tsk_term{"TERMTSK"};
-    static constexpr const char *tmr_gsm{"GSMTMR"};
     
     // serial line
     static constexpr const char *separator{"----------------------------------"};
     static constexpr const char *header{"Task         Runtime            %%"};
+    static constexpr const char *modemRx{"modem RX hwm %u ovr %u hwovr %u"};
+    static constexpr const char *modemUrc{"modem URC pending %u dropped %u"};
+    static constexpr const char *modemRecovery{"modem recovery tier %u %u ms"};
+    static constexpr const char *modemRecoveries{"modem recoveries %u last tier %u %u ms"};
+    static constexpr const char *smsOutbox{"sms out pending %u sent %u merged %u retries %u failed %u"};
+    static constexpr const char *bus{"bus      published %u in use %u hwm %u exhausted %u"};
+    static constexpr const char *lanes{"%-8s queue hwm %u drop %u coalesced %u view drop %u"};
 
 };
\ No newline at end of file
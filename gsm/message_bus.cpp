@@ -0,0 +1,133 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   message_bus.cpp
+/// @author Petr Vanek
+
+#include <memory.h>
+#include <algorithm>
+#include "message_bus.h"
+
+UBaseType_t MessageBus::lock(bool isr)
+{
+    if (isr)
+        return taskENTER_CRITICAL_FROM_ISR();
+    taskENTER_CRITICAL();
+    return 0;
+}
+
+void MessageBus::unlock(bool isr, UBaseType_t state)
+{
+    if (isr)
+    {
+        taskEXIT_CRITICAL_FROM_ISR(state);
+        return;
+    }
+    taskEXIT_CRITICAL();
+}
+
+bool MessageBus::subscribe(Topic topic, Sink sink, void *context)
+{
+    bool rc = false;
+    for (auto &subscriber : _subscribers[(std::size_t)topic])
+    {
+        if (subscriber._sink)
+            continue;
+
+        subscriber = Subscriber{sink, context};
+        rc = true;
+        break;
+    }
+    return rc;
+}
+
+bool MessageBus::publish(Topic topic, const void *header, std::size_t size, std::string_view text, bool isr)
+{
+    bool rc = false;
+    do
+    {
+        if (size >= _capacity)
+            break;
+
+        // free buffer, the publisher holds one reference until all subscribers got it
+        BusRef ref;
+        auto state = lock(isr);
+        for (std::size_t i = 0; i < _pool.size(); i++)
+        {
+            if (_pool[i]._refs)
+                continue;
+
+            _pool[i]._refs = 1;
+            ref._slot = (uint8_t)i;
+            _stats._inUse++;
+            _stats._highWater = std::max(_stats._highWater, _stats._inUse);
+            break;
+        }
+        if (!ref.isValid())
+            _stats._exhausted++;
+        unlock(isr, state);
+
+        if (!ref.isValid())
+            break;
+
+        // the only copy of the payload
+        auto &buffer = _pool[ref._slot];
+        auto length = std::min(text.size(), _capacity - size - 1);
+        memcpy(buffer._data, header, size);
+        memcpy(buffer._data + size, text.data(), length);
+        buffer._data[size + length] = '\0';
+        buffer._header = (uint8_t)size;
+        buffer._length = (uint8_t)length;
+
+        for (auto &subscriber : _subscribers[(std::size_t)topic])
+        {
+            if (!subscriber._sink)
+                break;
+
+            state = lock(isr);
+            buffer._refs++;
+            unlock(isr, state);
+
+            if (subscriber._sink(subscriber._context, topic, ref, isr))
+                rc = true;
+            else
+                release(ref, isr);
+        }
+
+        state = lock(isr);
+        _stats._published++;
+        unlock(isr, state);
+        release(ref, isr);
+    } while (false);
+    return rc;
+}
+
+std::string_view MessageBus::text(BusRef ref) const
+{
+    if (!ref.isValid())
+        return "";
+
+    auto &buffer = _pool[ref._slot];
+    return std::string_view(buffer._data + buffer._header, buffer._length);
+}
+
+void MessageBus::release(BusRef ref, bool isr)
+{
+    if (!ref.isValid())
+        return;
+
+    auto state = lock(isr);
+    auto &buffer = _pool[ref._slot];
+    if (buffer._refs && --buffer._refs == 0)
+        _stats._inUse--;
+    unlock(isr, state);
+}
+
+MessageBus::Stats MessageBus::stats() const
+{
+    auto state = lock(false);
+    auto rc = _stats;
+    unlock(false, state);
+    return rc;
+}
@@ -0,0 +1,159 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   message_bus.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <array>
+#include <cstddef>
+#include <inttypes.h>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief topics of the message bus
+ *
+ */
+enum class Topic : uint8_t
+{
+    outputState,    ///< OutputTask -> LCD, GSM and terminal task, OutputState (output_msg.h)
+    time,           ///< GSM task -> terminal task, TimeSample (terminal_msg.h)
+    telemetry,      ///< GSM task -> LCD task, TelemetryEvent (lcd_message.h) + operator name
+    displayLine,    ///< any task -> LCD task, DisplayLine (lcd_message.h) + text
+    count
+};
+
+/**
+ * @brief handle of the bus buffer, passed in the task messages instead of the payload.
+ * The receiver releases it by MessageBus::release.
+ *
+ */
+struct BusRef
+{
+    uint8_t _slot{0xff};
+
+    bool isValid() const { return _slot != 0xff; }
+};
+
+/**
+ * @brief publish / subscribe between the tasks. The payload is copied once into a preallocated,
+ * reference counted buffer, the subscribers get the handle (BusRef) in their own queue.
+ * The subscriptions are made at the start, before the tasks run.
+ *
+ */
+class MessageBus
+{
+public:
+    /**
+     * @brief subscriber, e.g. posts the handle into the task queue
+     *
+     * @return true - the handle is kept, the subscriber releases it
+     * @return false - not kept (refused or the payload copied), released by the bus
+     */
+    using Sink = bool (*)(void *context, Topic topic, BusRef ref, bool isr);
+
+    static constexpr std::size_t _buffers{20};          ///< pool, all the handles held at once, see Application
+    static constexpr std::size_t _capacity{48};         ///< header + text including the terminating zero
+    static constexpr std::size_t _maxSubscribers{3};    ///< per topic
+
+    /**
+     * @brief pool usage
+     *
+     */
+    struct Stats
+    {
+        uint32_t _published{0};
+        uint32_t _inUse{0};
+        uint32_t _highWater{0};
+        uint32_t _exhausted{0};     ///< publish failed, no free buffer
+    };
+
+    /**
+     * @brief new subscriber of the topic
+     *
+     * @param topic
+     * @param sink
+     * @param context - passed to the sink, e.g. the task
+     * @return true - success
+     * @return false - too many subscribers
+     */
+    bool subscribe(Topic topic, Sink sink, void *context);
+
+    /**
+     * @brief payload and a text, delivered to all subscribers of the topic
+     *
+     * @tparam P - payload structure, e.g. TimeSample
+     * @param topic
+     * @param payload
+     * @param text - longer text is cut to the buffer capacity
+     * @param isr - called from an interrupt
+     * @return true - kept at least by one subscriber
+     */
+    template <typename P>
+    bool publish(Topic topic, const P &payload, std::string_view text = {}, bool isr = false)
+    {
+        static_assert(std::is_trivially_copyable_v<P>, "the payload is copied into the buffer");
+        return publish(topic, &payload, sizeof(P), text, isr);
+    }
+
+    /**
+     * @brief payload of the handle
+     *
+     * @tparam P - type of the topic payload
+     * @return const P* - nullptr for an invalid handle or a different size
+     */
+    template <typename P>
+    const P *get(BusRef ref) const
+    {
+        if (!ref.isValid() || _pool[ref._slot]._header != sizeof(P))
+            return nullptr;
+        return reinterpret_cast<const P *>(_pool[ref._slot]._data);
+    }
+
+    /**
+     * @brief text of the handle, zero terminated
+     *
+     * @param ref
+     * @return std::string_view - empty, still zero terminated, for an invalid handle
+     */
+    std::string_view text(BusRef ref) const;
+
+    /**
+     * @brief the subscriber does not need the buffer any more, invalid handle is ignored
+     *
+     * @param ref
+     * @param isr - called from an interrupt
+     */
+    void release(BusRef ref, bool isr = false);
+
+    Stats stats() const;
+
+private:
+    bool publish(Topic topic, const void *header, std::size_t size, std::string_view text, bool isr);
+
+    struct Buffer
+    {
+        alignas(8) char _data[_capacity];
+        uint8_t _refs{0};
+        uint8_t _header{0};         ///< size of the payload structure
+        uint8_t _length{0};         ///< text after the header
+    };
+
+    struct Subscriber
+    {
+        Sink _sink{nullptr};
+        void *_context{nullptr};
+    };
+
+    static UBaseType_t lock(bool isr);
+    static void unlock(bool isr, UBaseType_t state);
+
+    std::array<Buffer, _buffers> _pool{};
+    std::array<std::array<Subscriber, _maxSubscribers>, (std::size_t)Topic::count> _subscribers{};
+    Stats _stats;
+};
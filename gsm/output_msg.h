@@ -20,8 +20,6 @@ enum class OutputTypeMsg
 {
 	writeone,		 ///< set pin to ON or OFF
 	writeAllOff,	 ///< all pins to OFF
-	readall,		 ///< for UI view
-	readallTerm,	 ///< for terminal control
 	writeAllOffTerm, ///< for terminal control
 	none
 };
@@ -37,3 +35,14 @@ public:
 	uint32_t _output{0};							 ///< identify output mask or pin
 	bool _value{false};								 ///< state
 };
+
+/**
+ * @brief Topic::outputState, published by the Output task after every write
+ *
+ */
+struct OutputState
+{
+	uint32_t _mask{0};	 ///< real pin position, see OutputTask::outputsToString
+	uint32_t _seq{0};	 ///< writes processed, the state includes the write of OutputTask::message returning _seq or less
+	uint64_t _stampUs{0}; ///< [us] time_us_64() of the write
+};
@@ -20,14 +20,11 @@
 
 OutputTask::OutputTask()
 {
-    _queueRequest = xQueueCreate(5, sizeof(OutputMsg));
 }
 
 OutputTask::~OutputTask()
 {
     done();
-    if (_queueRequest)
-        vQueueDelete(_queueRequest);
 }
 
 uint32_t OutputTask::getOutputmask()
@@ -105,11 +102,6 @@ std::string OutputTask::outputsToString(const uint32_t outputs)
 void OutputTask::loop()
 {
     uint32_t outputs = 0; // image of outputs - real pin position
-    LCDMessage lcdmsg;
-    GSMMessage gsmmsg;
-    std::string tmp;
-    uint32_t cntx = 0;
-    TerminalMessage trmmsg;
 
     auto mask = getOutputmask();
     gpio_init_mask(mask);
@@ -119,8 +111,7 @@ void OutputTask::loop()
     while (true)
     { // Loop forever
         OutputMsg msg;
-        auto res = xQueueReceive(_queueRequest, (void *)&msg, (TickType_t)50 / portTICK_PERIOD_MS);
-        if (res == pdTRUE)
+        if (_lanes.receive(msg, (TickType_t)50 / portTICK_PERIOD_MS))
         {
             switch (msg._messageType)
             {
@@ -129,6 +120,7 @@ void OutputTask::loop()
 
                 outputs = 0;
                 gpio_clr_mask(mask); // all pins OFF
+                publish(outputs);
 
                 break;
 
@@ -144,43 +136,28 @@ void OutputTask::loop()
                     gpio_clr_mask(1ul << (msg._output));
                     outputs &= ~(1ul << msg._output);
                 }
+                publish(outputs);
 
                 break;
 
-            case OutputTypeMsg::readall:
-
-                lcdmsg._messageType = LCDMessageType::idcaller;
-                lcdmsg._value = outputs;
-                memset(&lcdmsg._message, 0, sizeof(lcdmsg._message));
-                cntx = 0;
-                tmp.clear();
-                tmp += literals::output;
-                tmp += outputsToString(outputs);
-                strncpy(lcdmsg._message, tmp.c_str(), sizeof(lcdmsg._message) - 1);
-                Application::getInstance()->getLCDTask()->message(lcdmsg, false);
-
-                memset(gsmmsg._message, 0, sizeof(gsmmsg._message));
-                strncpy(gsmmsg._message, tmp.c_str(), sizeof(lcdmsg._message) - 1);
-                gsmmsg._messageType = GSMMessageType::state;
-                Application::getInstance()->getGSMTask()->message(gsmmsg, false);
-                break;
-
-            case OutputTypeMsg::readallTerm:
-                trmmsg._messageType = TerminalMessageType::readAllAck;
-                trmmsg._value = outputsToOrder(outputs);
-                Application::getInstance()->getTerminalTask()->message(trmmsg, false);
-                break;
-
             case OutputTypeMsg::writeAllOffTerm:
-
+            {
                 gpio_clr_mask(mask); // all pins OFF
                 outputs = 0;
+                publish(outputs);
+
                 TerminalMessage trmmsg;
                 trmmsg._messageType = TerminalMessageType::clearAllAck;
                 trmmsg._value = outputs;
                 Application::getInstance()->getTerminalTask()->message(trmmsg, false);
                 break;
             }
+
+            default:
+                // counted as a write, see message
+                publish(outputs);
+                break;
+            }
         }
     }
 }
@@ -190,22 +167,28 @@ bool OutputTask::init(const char *name, UBaseType_t priority, const configSTACK_
     return RPTask::init(name, priority, stackDepth);
 }
 
-void OutputTask::writeToOutput(uint8_t outputId, bool on, bool isr)
+uint32_t OutputTask::writeToOutput(uint8_t outputId, bool on, bool isr)
 {
     OutputMsg msg;
     msg._value = on;
     msg._output = outputId;
     msg._messageType = OutputTypeMsg::writeone;
-    if (_queueRequest)
-    {
-        (isr) ? xQueueSendToBackFromISR(_queueRequest, (void *)&msg, 0) : xQueueSendToBack(_queueRequest, (void *)&msg, 0);
-    }
+    return message(msg, isr);
 }
 
-void OutputTask::message(const OutputMsg &msg, bool isr)
+uint32_t OutputTask::message(const OutputMsg &msg, bool isr)
 {
-    if (_queueRequest)
-    {
-        (isr) ? xQueueSendToBackFromISR(_queueRequest, (void *)&msg, 0) : xQueueSendToBack(_queueRequest, (void *)&msg, 0);
-    }
+    // every queued message is one write of the loop, counted by _state._seq in the same order
+    uint32_t seq = 0;
+    _lanes.post(msg, isr, 0, &seq);
+    return seq;
+}
+
+void OutputTask::publish(uint32_t outputs)
+{
+    // the subscribers get it before the next write is processed
+    _state._mask = outputs;
+    _state._seq++;
+    _state._stampUs = time_us_64();
+    Application::getInstance()->getBus()->publish(Topic::outputState, _state);
 }
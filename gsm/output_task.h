@@ -14,6 +14,7 @@
 #include "rptask.h"
 #include "hardware.h"
 #include "output_msg.h"
+#include "src-utils/message_lanes.h"
 
 /**
  * @brief Task for outputs control
@@ -26,11 +27,24 @@ public:
 	OutputTask();
 	virtual ~OutputTask();
     virtual bool init(const char * name, UBaseType_t priority = tskIDLE_PRIORITY, const configSTACK_DEPTH_TYPE stackDepth = configMINIMAL_STACK_SIZE) override;
-	void writeToOutput(uint8_t outputId, bool on, bool isr);
-	void message(const OutputMsg& msg, bool isr);
+	uint32_t writeToOutput(uint8_t outputId, bool on, bool isr);
+	/**
+	 * @brief writes in the control lane, the state is published by Topic::outputState
+	 * 
+	 * @param msg 
+	 * @param isr 
+	 * @return uint32_t - OutputState::_seq of the state after this write, 0 - not queued
+	 */
+	uint32_t message(const OutputMsg& msg, bool isr);
 
-protected:
-	void loop() override;
+	using Lanes = MessageLanes<OutputMsg, 8, 0>;
+
+	/**
+	 * @brief request queue, overflow statistics
+	 *
+	 * @return const Lanes&
+	 */
+	const Lanes &lanes() const { return _lanes; }
 
 	/**
 	 * @brief map from real pins position into mapped to string  1-7 
@@ -38,7 +52,7 @@ protected:
 	 * @param outputs - real pin mask position 
 	 * @return std::string 
 	 */
-	std::string outputsToString(const uint32_t outputs);
+	static std::string outputsToString(const uint32_t outputs);
 
 	/**
 	 * @brief map from real pins position to bit position bit 1, 2, 4, 8 .. 
@@ -46,11 +60,23 @@ protected:
 	 * @param outputs 
 	 * @return uint32_t 
 	 */
-	uint32_t outputsToOrder(const uint32_t outputs);
+	static uint32_t outputsToOrder(const uint32_t outputs);
+
+protected:
+	void loop() override;
+
+	/**
+	 * @brief Topic::outputState after the write, also if the outputs have not been changed,
+	 * the readers wait for the _seq of their write
+	 * 
+	 * @param outputs - real pin mask position
+	 */
+	void publish(uint32_t outputs);
 
 private:
 
 	uint32_t getOutputmask();
-    QueueHandle_t 	_queueRequest;
+	Lanes _lanes;		///< requests
+	OutputState _state;	///< the last published state
    
 };
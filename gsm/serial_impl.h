@@ -8,8 +8,13 @@
 #pragma once
 
 #include <stdio.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
 #include "pico/stdlib.h"
+#include "hardware/irq.h"
 #include "src-gsm/gsm.h"
+#include "src-utils/ring_buffer.h"
 #include "hardware.h"
 
 namespace gsm {
@@ -18,28 +23,40 @@ namespace gsm {
  * @brief
  *
  */
-class SerialImpl : public ISerialModem
+class SerialImpl final : public ISerialModem
 {
 public:
-    bool isReadable() override
+    SerialImpl() : _rxReady(xSemaphoreCreateBinary()) {}
+
+    /**
+     * @brief given by the ISR with every received line (or idle line), the GSM task waits for it
+     * in its queue set, together with the requests
+     *
+     * @return SemaphoreHandle_t
+     */
+    SemaphoreHandle_t rxReady() const
     {
-        return uart_is_readable(GSM_UART_ID0); 
+        return _rxReady;
     }
 
-    bool isWritable() override
+    bool isReadable() override
     {
-        return uart_is_writable(GSM_UART_ID0);
+        return !_rx.empty();
     }
-    void putch(char c) override
+
+    std::size_t read(char *buffer, std::size_t size, char delimiter) override
     {
-        //printf(">%c<",c);
-        uart_putc_raw(GSM_UART_ID0, c);
+        return _rx.pop(buffer, size, delimiter);
     }
-    char getc() override
+
+    std::size_t write(std::string_view data) override
     {
-        char c  = uart_getc(GSM_UART_ID0);
-        //printf("%c",c);
-        return c;
+        std::size_t count = 0;
+        while (count < data.size() && uart_is_writable(GSM_UART_ID0))
+        {
+            uart_putc_raw(GSM_UART_ID0, data[count++]);
+        }
+        return count;
     }
 
     void delay(uint16_t ms) override
@@ -52,17 +69,38 @@ public:
         return time_us_64();
     }
 
+    bool waitReadable(uint32_t maxWait) override
+    {
+        // register first, the ISR notification is then never lost
+        _waiter = xTaskGetCurrentTaskHandle();
+        if (_rx.empty())
+        {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(maxWait));
+        }
+        _waiter = nullptr;
+        return !_rx.empty();
+    }
+
     void hardwareInit() override
     {
         gpio_init(POWER_ENABLE);
         gpio_set_dir(POWER_ENABLE, GPIO_OUT);
         gpio_put(POWER_ENABLE, 1);
 
+        irq_set_enabled(UART0_IRQ, false);
+        _instance = this;
+        _rx.clear();
+
         uart_init(GSM_UART_ID0, GSM_BAUD_RATE);
         gpio_set_function(GSM_UART_TX_PIN0, GPIO_FUNC_UART);
         gpio_set_function(GSM_UART_RX_PIN0, GPIO_FUNC_UART);
 
         uart_set_fifo_enabled(GSM_UART_ID0, true);
+
+        // RX FIFO level + RX timeout interrupts, the ring buffer is filled from ISR
+        irq_set_exclusive_handler(UART0_IRQ, &uartRxIRQHandle);
+        irq_set_enabled(UART0_IRQ, true);
+        uart_set_irq_enables(GSM_UART_ID0, true, false);
     }
 
     void modemInit() override
@@ -73,8 +111,86 @@ public:
         delay(500);
         gpio_put(POWER_ENABLE,1);
         delay(2000);
-    
+
+    }
+
+    /**
+     * @brief bytes dropped because the ring buffer was full
+     *
+     * @return uint32_t
+     */
+    uint32_t overruns() const
+    {
+        return _rx.overruns();
+    }
+
+    /**
+     * @brief bytes lost in the hardware FIFO before the ISR read them
+     *
+     * @return uint32_t
+     */
+    uint32_t hwOverruns() const
+    {
+        return _hwOverruns;
+    }
+
+    /**
+     * @brief maximum fill level of the ring buffer
+     *
+     * @return uint32_t
+     */
+    uint32_t highWater() const
+    {
+        return _rx.highWater();
     }
+
+private:
+    static constexpr std::size_t _rxBufferSize{1024};
+
+    /**
+     * @brief UART0 RX ISR - drains the hardware FIFO into the ring buffer,
+     * the waiting task is woken at the end of line or when the line becomes idle (e.g. "> " prompt),
+     * the line is signalled to the task loop by _rxReady
+     *
+     */
+    static void uartRxIRQHandle()
+    {
+        auto self = _instance;
+        if (!self)
+            return;
+
+        auto hw = uart_get_hw(GSM_UART_ID0);
+        bool wake = (hw->mis & UART_UARTMIS_RTMIS_BITS) != 0;
+
+        while (uart_is_readable(GSM_UART_ID0))
+        {
+            auto dr = hw->dr;
+            if (dr & UART_UARTDR_OE_BITS)
+                self->_hwOverruns++;
+
+            char c = (char)(dr & 0xff);
+            self->_rx.push(c);
+            if (c == _ignorelineDelim)
+                wake = true;
+        }
+
+        if (!wake)
+            return;
+
+        BaseType_t woken = pdFALSE;
+        TaskHandle_t waiter = self->_waiter;
+        if (waiter)
+            vTaskNotifyGiveFromISR(waiter, &woken);
+        if (self->_rxReady)
+            xSemaphoreGiveFromISR(self->_rxReady, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+
+    inline static SerialImpl *_instance{nullptr};   ///< ISR context
+    RingBuffer<char, _rxBufferSize> _rx;             ///< received bytes
+    volatile TaskHandle_t _waiter{nullptr};          ///< task blocked in waitReadable
+    SemaphoreHandle_t _rxReady;                      ///< line received, binary
+    volatile uint32_t _hwOverruns{0};                ///< hardware FIFO overruns
 };
 
-} //namespace gsm 
\ No newline at end of file
+} //namespace gsm
@@ -0,0 +1,196 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   at_decoder.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+#include <charconv>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+namespace gsm {
+
+/**
+ * @brief schema driven decoder of comma separated AT response values,
+ * e.g. decode<Quoted, Int, Int>(R"("SM",2,30)") -> tuple<string_view, int32_t, int32_t>
+ * Fields are separated by comma, spaces around fields are ignored,
+ * content behind the last field is ignored. No allocation, views point into the input.
+ */
+namespace decoder {
+
+struct Int {};      ///< signed decimal number -> int32_t
+struct Quoted {};   ///< "text", may contain commas -> string_view without quotes
+struct Text {};     ///< raw field up to the next comma, may be empty -> string_view
+
+inline void skipSpaces(std::string_view &in)
+{
+    while (!in.empty() && (in.front() == ' ' || in.front() == '\t'))
+        in.remove_prefix(1);
+}
+
+inline std::string_view trim(std::string_view in)
+{
+    skipSpaces(in);
+    while (!in.empty() && (in.back() == ' ' || in.back() == '\t' || in.back() == '\r' || in.back() == '\n'))
+        in.remove_suffix(1);
+    return in;
+}
+
+/**
+ * @brief consumes expected char
+ *
+ * @param in - input, moved behind the char
+ * @param c - expected char
+ * @return true - found
+ */
+inline bool expect(std::string_view &in, char c)
+{
+    if (in.empty() || in.front() != c)
+        return false;
+    in.remove_prefix(1);
+    return true;
+}
+
+/**
+ * @brief consumes a number
+ *
+ * @tparam T - integer type
+ * @param in - input, moved behind the number
+ * @param out - value
+ * @return true - valid number
+ */
+template <typename T>
+bool number(std::string_view &in, T &out)
+{
+    auto [ptr, ec] = std::from_chars(in.data(), in.data() + in.size(), out);
+    if (ec != std::errc())
+        return false;
+    in.remove_prefix(ptr - in.data());
+    return true;
+}
+
+/**
+ * @brief fixed width number, e.g. the parts of "20230304082223.000"
+ *
+ * @tparam T - integer type
+ * @param in - input
+ * @param pos - position
+ * @param len - number of digits
+ * @param out - value
+ * @return true - all the digits are valid
+ */
+template <typename T>
+bool number(std::string_view in, std::size_t pos, std::size_t len, T &out)
+{
+    if (pos + len > in.size())
+        return false;
+    auto part = in.substr(pos, len);
+    return number(part, out) && part.empty();
+}
+
+/**
+ * @brief value part of the "key: value" line
+ *
+ * @param line
+ * @return std::string_view - trimmed value, empty if there is no key
+ */
+inline std::string_view valueOf(std::string_view line)
+{
+    auto pos = line.find(':');
+    if (pos == std::string_view::npos || pos == 0)
+        return {};
+    return trim(line.substr(pos + 1));
+}
+
+template <typename F>
+struct Field;
+
+template <>
+struct Field<Int>
+{
+    using type = int32_t;
+    static bool parse(std::string_view &in, type &out)
+    {
+        return number(in, out);
+    }
+};
+
+template <>
+struct Field<Quoted>
+{
+    using type = std::string_view;
+    static bool parse(std::string_view &in, type &out)
+    {
+        if (!expect(in, '"'))
+            return false;
+        auto end = in.find('"');
+        if (end == std::string_view::npos)
+            return false;
+        out = in.substr(0, end);
+        in.remove_prefix(end + 1);
+        return true;
+    }
+};
+
+template <>
+struct Field<Text>
+{
+    using type = std::string_view;
+    static bool parse(std::string_view &in, type &out)
+    {
+        auto end = in.find(',');
+        out = trim(in.substr(0, end));
+        in.remove_prefix((end == std::string_view::npos) ? in.size() : end);
+        return true;
+    }
+};
+
+template <typename F>
+bool field(std::string_view &in, typename Field<F>::type &out, bool first)
+{
+    skipSpaces(in);
+    if (!first)
+    {
+        if (!expect(in, ','))
+            return false;
+        skipSpaces(in);
+    }
+    return Field<F>::parse(in, out);
+}
+
+template <typename... F, std::size_t... I>
+bool fields(std::string_view in, std::tuple<typename Field<F>::type...> &out, std::index_sequence<I...>)
+{
+    bool rc = true;
+    ((rc = rc && field<F>(in, std::get<I>(out), I == 0)), ...);
+    return rc;
+}
+
+} // namespace decoder
+
+template <typename... F>
+using Decoded = std::tuple<typename decoder::Field<F>::type...>;
+
+/**
+ * @brief decode comma separated values
+ *
+ * @tparam F - schema, decoder::Int, decoder::Quoted, decoder::Text
+ * @param values - input, e.g. value part of the response line
+ * @return std::optional<Decoded<F...>> - if all the fields are valid
+ */
+template <typename... F>
+std::optional<Decoded<F...>> decode(std::string_view values)
+{
+    Decoded<F...> rc{};
+    if (!decoder::fields<F...>(values, rc, std::index_sequence_for<F...>{}))
+        return std::nullopt;
+    return rc;
+}
+
+} //namespace gsm
@@ -12,9 +12,7 @@
 #include <string>
 #include <string_view>
 #include <typeinfo>
-#include <unordered_set>
-#include <unordered_map>
-#include <vector>
+#include <utility>
 
 using namespace std::literals;
 
@@ -39,14 +37,14 @@ namespace gsm {
         exec
     };
 
-    const std::unordered_set<std::string_view> AtBeginLUT = {
+    constexpr char AtBeginLUT[] = {
 
-        "+"sv,  // AT+...
-        "#"sv,  // AT#...
-        "$"sv,  // AT$...
-        "%"sv,  // AT%...
-        "\\"sv, // AT\...
-        "&"sv,   // AT&...
+        '+',  // AT+...
+        '#',  // AT#...
+        '$',  // AT$...
+        '%',  // AT%...
+        '\\', // AT\...
+        '&',  // AT&...
     };
 
     enum class ResponseStatus
@@ -63,15 +61,27 @@ namespace gsm {
         newsms,
         callerid,
         nodial,
-        msgnum
+        msgnum,
+        powerdown,
+        directsms
     };
 
-    using Responses = std::vector<std::string>;
-    using ReqMap = std::unordered_map<std::string_view, QueryType>;
-    using RespMapStatus = std::unordered_map<std::string_view, ResponseStatus>;
     using KeyValue = std::pair<std::string, std::string>;
 
-    const ReqMap AtEndLUT{
+    struct QueryToken
+    {
+        std::string_view _token;
+        QueryType _type;
+    };
+
+    struct StatusToken
+    {
+        std::string_view _token;
+        ResponseStatus _status;
+    };
+
+    // longer suffixes first, the first match wins
+    constexpr QueryToken AtEndLUT[]{
         {"=?"sv, QueryType::test}, // e.g. AT+COPS=?
         {"?"sv, QueryType::get},   // e.g  AT+CPIN?
         {"="sv, QueryType::set},   // e.g. AT+CBC =”+923140”, 110
@@ -79,9 +89,10 @@ namespace gsm {
         {"\r"sv, QueryType::exec} // AT+CSQ,
     };
 
-    const RespMapStatus ATStatus{
+    // compiled into AtStatusMatcher (at_matcher.h), the longest matching prefix of the line wins
+    constexpr StatusToken ATStatus[]{
         {"CLIP"sv, ResponseStatus::callerid},  ///< special case
-        {"> ", ResponseStatus::smsready},       ///< special case
+        {"> "sv, ResponseStatus::smsready},       ///< special case
         
         {"RING"sv, ResponseStatus::ring},
         {"OK"sv, ResponseStatus::ok},
@@ -97,17 +108,18 @@ namespace gsm {
         {"CLOSED"sv, ResponseStatus::status},
         {">"sv, ResponseStatus::status},
         {"VOICE CALL: END"sv, ResponseStatus::status},
-        {"CALL READY", ResponseStatus::status},
-        {"SMS READY", ResponseStatus::status},
-        {"NORMAL POWER DOWN", ResponseStatus::status},
-        {"CCLK:", ResponseStatus::clock},
+        {"CALL READY"sv, ResponseStatus::status},
+        {"SMS READY"sv, ResponseStatus::status},
+        {"NORMAL POWER DOWN"sv, ResponseStatus::powerdown},
+        {"CCLK:"sv, ResponseStatus::clock},
         
-        {"BUSY", ResponseStatus::busy},
+        {"BUSY"sv, ResponseStatus::busy},
         
 
-        {"CMTI",ResponseStatus::newsms},
-        {"NO CARRIER", ResponseStatus::nocarrier},
-        {"NO DIALTONE", ResponseStatus::nodial},
+        {"CMTI"sv,ResponseStatus::newsms},
+        {"CMT:"sv,ResponseStatus::directsms},
+        {"NO CARRIER"sv, ResponseStatus::nocarrier},
+        {"NO DIALTONE"sv, ResponseStatus::nodial},
         
         {"UNKNOWN"sv, ResponseStatus::unknown} // fake state
 
@@ -0,0 +1,212 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   at_matcher.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+#include <cstddef>
+#include <string_view>
+#include "at_enums.h"
+
+namespace gsm {
+
+/**
+ * @brief upper bound of the trie nodes - root + one node per token char
+ *
+ * @return constexpr std::size_t
+ */
+constexpr std::size_t statusTrieNodes()
+{
+    std::size_t rc = 1;
+    for (const auto &t : ATStatus)
+        rc += t._token.size();
+    return rc;
+}
+
+/**
+ * @brief prefix trie of the ATStatus tokens, built at compile time.
+ * The input alphabet is reduced to the characters used by the tokens,
+ * the matching is case insensitive (ASCII).
+ *
+ */
+class StatusTrie
+{
+public:
+    static constexpr uint8_t _dead{0};      ///< no transition, root is never a target
+    static constexpr uint8_t _root{0};
+    static constexpr std::size_t _classes{30};
+
+    /**
+     * @brief maps input char into the trie alphabet, 0 - not used by any token
+     *
+     * @param c
+     * @return constexpr uint8_t
+     */
+    static constexpr uint8_t charClass(char c)
+    {
+        if (c >= 'a' && c <= 'z')
+            return (uint8_t)(c - 'a' + 1);
+        if (c >= 'A' && c <= 'Z')
+            return (uint8_t)(c - 'A' + 1);
+        if (c == ' ')
+            return 27;
+        if (c == '>')
+            return 28;
+        if (c == ':')
+            return 29;
+        return 0;
+    }
+
+    constexpr StatusTrie()
+    {
+        for (const auto &t : ATStatus)
+        {
+            std::size_t node = _root;
+            for (auto c : t._token)
+            {
+                auto cls = charClass(c);
+                if (_next[node][cls] == _dead)
+                    _next[node][cls] = (uint8_t)_nodes++;
+                node = _next[node][cls];
+            }
+
+            // the first token wins on duplicates
+            if (!_accept[node])
+            {
+                _accept[node] = true;
+                _status[node] = t._status;
+            }
+
+            auto idx = (std::size_t)t._status;
+            if (_token[idx].empty())
+                _token[idx] = t._token;
+        }
+    }
+
+    /**
+     * @brief transition
+     *
+     * @param node - current node
+     * @param c - input char
+     * @return uint8_t - next node or _dead
+     */
+    constexpr uint8_t next(uint8_t node, char c) const
+    {
+        auto cls = charClass(c);
+        return cls ? _next[node][cls] : _dead;
+    }
+
+    constexpr bool isAccepting(uint8_t node) const { return _accept[node]; }
+    constexpr ResponseStatus status(uint8_t node) const { return _status[node]; }
+
+    /**
+     * @brief the first token defined for the status
+     *
+     * @param status
+     * @return std::string_view - empty if not defined
+     */
+    constexpr std::string_view token(ResponseStatus status) const { return _token[(std::size_t)status]; }
+
+private:
+    static constexpr std::size_t _statuses{(std::size_t)ResponseStatus::directsms + 1};
+    static constexpr std::size_t _maxNodes{statusTrieNodes()};
+    static_assert(_maxNodes < 256, "trie node index must fit into uint8_t");
+
+    uint8_t _next[_maxNodes][_classes]{};           ///< transitions
+    bool _accept[_maxNodes]{};                      ///< node terminates a token
+    ResponseStatus _status[_maxNodes]{};            ///< status of the terminated token
+    std::string_view _token[_statuses]{};           ///< status -> token
+    std::size_t _nodes{1};                          ///< allocated nodes
+};
+
+inline constexpr StatusTrie ATStatusTrie{};
+
+/**
+ * @brief incremental matcher of the line beginning, advances one trie node per byte.
+ * Remembers the longest token matched so far, e.g. "> " (smsready) wins over ">" (status).
+ *
+ */
+class AtStatusMatcher
+{
+public:
+    void reset()
+    {
+        _node = ATStatusTrie._root;
+        _alive = true;
+        _matched = false;
+        _status = ResponseStatus::unknown;
+    }
+
+    /**
+     * @brief advance by one char of the line
+     *
+     * @param c
+     * @return true - the line (so far) starts with a token
+     */
+    bool advance(char c)
+    {
+        if (_alive)
+        {
+            _node = ATStatusTrie.next(_node, c);
+            if (_node == ATStatusTrie._dead)
+            {
+                _alive = false;
+            }
+            else if (ATStatusTrie.isAccepting(_node))
+            {
+                _matched = true;
+                _status = ATStatusTrie.status(_node);
+            }
+        }
+        return _matched;
+    }
+
+    bool isMatched() const { return _matched; }
+    ResponseStatus status() const { return _status; }
+
+    /**
+     * @brief classify the whole line at once
+     *
+     * @param line
+     * @return AtStatusMatcher&
+     */
+    AtStatusMatcher &match(std::string_view line)
+    {
+        reset();
+        for (auto c : line)
+        {
+            if (!_alive)
+                break;
+            advance(c);
+        }
+        return *this;
+    }
+
+private:
+    uint8_t _node{ATStatusTrie._root};
+    bool _alive{true};
+    bool _matched{false};
+    ResponseStatus _status{ResponseStatus::unknown};
+};
+
+/**
+ * @brief AT prefix char after the "AT" of the command echo
+ *
+ * @param c
+ * @return true
+ */
+constexpr bool isAtBegin(char c)
+{
+    for (auto b : AtBeginLUT)
+    {
+        if (b == c)
+            return true;
+    }
+    return false;
+}
+
+} //namespace gsm
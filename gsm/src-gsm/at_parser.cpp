@@ -33,36 +33,58 @@ void ATParser::invalidContnet()
 {
     _query.clear();
     _answer.clear();
-    _buffer.clear();
     _queryParam.clear();
+    resetLine();
 
     _queryType = QueryType::unknown;
     _status = ResponseStatus::unknown;
 }
 
+void ATParser::append(char inp)
+{
+    if (_answer.append(inp))
+    {
+        _matcher.advance(inp);
+        if (inp == '"')
+            _quotes++;
+    }
+}
+
+void ATParser::resetLine()
+{
+    _answer.reset();
+    _matcher.reset();
+    _quotes = 0;
+}
+
+void ATParser::commitLine()
+{
+    _answer.commit();
+    _matcher.reset();
+    _quotes = 0;
+}
+
 void ATParser::parseAnswerContent(char inp)
 {
 
     if (inp == _lineDelim)
     {
-        if (!_buffer.empty())
+        auto buffer = _answer.current();
+        if (!buffer.empty())
         {
             if (_prefferdResponse == ResponseStatus::unknown)
             {
-                // search first valid status
-                auto part = std::find_if(ATStatus.begin(), ATStatus.end(), [this](const auto &item)
-                                         { return startsWith(_buffer, item.first); });
-
-                if (part != ATStatus.end())
+                // first valid status, already known from the matcher
+                if (_matcher.isMatched())
                 {
                     // finished
                     _flow = ParseCode::aEnd;
-                    _status = part->second;
-                    _answer.emplace_back(_buffer);
+                    _status = _matcher.status();
+                    commitLine();
                 }
                 else
                 {
-                    _answer.emplace_back(_buffer);
+                    commitLine();
                     if (_answer.size() > _maxLinesResponse)
                     {
                         // invalid data - too long response or invalid data source
@@ -73,72 +95,57 @@ void ATParser::parseAnswerContent(char inp)
             }
             else
             {
-                auto part = std::find_if(ATStatus.begin(), ATStatus.end(), [this](const auto &item)
-                                         { 
-                    if (_prefferdResponse ==  item.second) {
-                        return true;
-                    }
-                    return false; });
-
-                if (part != ATStatus.end())
+                auto token = ATStatusTrie.token(_prefferdResponse);
+                if (!token.empty())
                 {
-                    // search preffered
+                    // search preffered, the final result code only as the whole line, never inside a text
                     _flow = ParseCode::aBegin;
-                    if (containString(_buffer, part->first))
+                    bool final = _prefferdResponse == ResponseStatus::ok || _prefferdResponse == ResponseStatus::error;
+                    if (final ? compareInsensitiveStr(decoder::trim(buffer), token) : containString(buffer, token))
                     {
-                        _status = part->second;
-                        _answer.emplace_back(_buffer);
+                        _status = _prefferdResponse;
+                        commitLine();
                         _flow = ParseCode::aEnd;
                     }
                     else
                     {
-                        if (!_buffer.empty())
-                        {
-                            _answer.emplace_back(_buffer);
-                        }
+                        commitLine();
                     }
                 }
             }
         }
 
-        _buffer.clear();
+        resetLine();
     }
     else
     {
-        _buffer += inp;
+        append(inp);
+        specialCase();
     }
-
-    specialCase();
 }
 
 void ATParser::specialCase()
 {
     if (_prefferdResponse == ResponseStatus::smsready || _prefferdResponse == ResponseStatus::unknown)
     {
-
-        auto part = std::find_if(ATStatus.begin(), ATStatus.end(), [this](const auto &item)
-                                 { return startsWith(_buffer, item.first); });
-
-        if (part != ATStatus.end())
+        if (_matcher.isMatched())
         {
-            if (part->second == ResponseStatus::smsready)
+            auto status = _matcher.status();
+            if (status == ResponseStatus::smsready)
             {
-                _status = part->second;
-                _answer.emplace_back(_buffer);
+                _status = status;
+                commitLine();
                 _flow = ParseCode::aEnd;
             }
-
-            if (part->second == ResponseStatus::callerid)
+            else if (status == ResponseStatus::callerid)
             { // there is no terminating character at the end
-                // TODO: when it's time to optimize 
-                _status = part->second;
-                if (!betweenMarks(_buffer).empty()) {
-                    _answer.emplace_back(_buffer);
+                _status = status;
+                // the number is complete with the closing quote
+                if (_quotes >= 2 && !betweenMarks(_answer.current()).empty()) {
+                    commitLine();
                     _flow = ParseCode::aEnd;
                 }
-                
             }
-
         }
     }
     
@@ -146,46 +153,40 @@ void ATParser::specialCase()
 
 void ATParser::parseQueryContent(char inp)
 {
-    _buffer += inp;
-    auto part = std::find_if(AtEndLUT.begin(), AtEndLUT.end(), [this](const auto &item)
-                             {
-   
-        auto rc = endsWith(_buffer, item.first);
-        if (rc) {
-            auto sz = item.first.length(); 
-            // delete end delimiter
-            _buffer.erase(_buffer.length()- sz, sz);
-        }
-        return rc; });
+    _answer.append(inp);
+    auto part = std::find_if(std::begin(AtEndLUT), std::end(AtEndLUT), [this](const auto &item)
+                             { return endsWith(_answer.current(), item._token); });
 
-    if (part != AtEndLUT.end())
+    if (part != std::end(AtEndLUT))
     {
+        // delete end delimiter
+        _answer.discard(part->_token.length());
 
-        if (part->second == QueryType::exec)
+        if (part->_type == QueryType::exec)
         {
             // exec - finalize
 
             if (_queryType == QueryType::unknown)
             {
                 // exec without param
-                _queryType = part->second;
-                _query = _buffer;
+                _queryType = part->_type;
+                _query = _answer.current();
             }
             else
             {
                 // collected query param
-                _queryParam = _buffer;
+                _queryParam = _answer.current();
             }
 
             _flow = ParseCode::aBegin;
         }
         else
         {
-            _queryType = part->second;
-            _query = _buffer;
+            _queryType = part->_type;
+            _query = _answer.current();
         }
 
-        _buffer.clear();
+        resetLine();
     }
 }
 
@@ -194,16 +195,14 @@ void ATParser::parseAnswerBegin(char inp)
 
     if (inp != _lineDelim)
     {
-        _buffer += inp;
-        auto part = std::find_if(AtBeginLUT.begin(), AtBeginLUT.end(), [this](const auto &item)
-                                 { return startsWith(_buffer, item); });
-
-        if (part != AtBeginLUT.end())
+        if (isAtBegin(inp) && _answer.current().empty())
         {
-            _buffer.clear();
+            // AT prefix char, ignore
+            resetLine();
         }
         else
         {
+            append(inp);
             _flow = ParseCode::aContent;
         }
     }
@@ -223,8 +222,6 @@ bool ATParser::parse(std::string_view inp)
 
 bool ATParser::parse(char inp)
 {
-    std::string part;
-
     do
     {
 
@@ -238,7 +235,7 @@ bool ATParser::parse(char inp)
         // Query begin
         case ParseCode::qBegin:
             invalidContnet();
-            _buffer += inp;
+            append(inp);
             _flow = ParseCode::qContent;
             break;
 
@@ -266,16 +263,16 @@ bool ATParser::parse(char inp)
     return (_flow == ParseCode::aEnd);
 }
 
-std::string ATParser::betweenMarks(std::string_view strValue, std::string_view mark)
+std::string_view ATParser::betweenMarks(std::string_view strValue, std::string_view mark)
 {
-    std::string str;
+    std::string_view str;
     size_t begin = strValue.find(mark);
 
-    if (begin != std::string::npos)
+    if (begin != std::string_view::npos)
     {
         size_t end = strValue.find(mark, begin + 1);
 
-        if (end != std::string::npos)
+        if (end != std::string_view::npos)
         {
             str = strValue.substr(begin + 1, end - begin - 1);
         }
@@ -341,13 +338,12 @@ std::optional<bool> ATParser::compareResponseText(std::string_view input)
         if (_answer.empty())
             break;
 
-        for (auto x : _answer)
+        for (const auto &x : _answer)
         {
-            auto kv = getKeyValue(x);
-            if (kv.first.empty() || kv.second.empty())
+            auto value = decoder::valueOf(x);
+            if (value.empty())
                 continue;
-            eatWhiteSpaces(kv.second);
-            rc = compareInsensitiveStr(std::string_view(kv.second), input);
+            rc = compareInsensitiveStr(value, input);
             break;
         }
     } while (false);
@@ -363,14 +359,14 @@ std::optional<std::string> ATParser::getText(std::string_view ignore)
         if (_answer.empty())
             break;
 
-        for (auto x : _answer)
+        for (const auto &x : _answer)
         {
-            if (x.empty())
+            auto str = decoder::trim(x);
+            if (str.empty())
                 continue;
-            if (!ignore.empty() && findInsensitiveStr(std::string_view(x), ignore) != std::string::npos)
+            if (!ignore.empty() && findInsensitiveStr(str, ignore) != std::string::npos)
                 continue;
-            eatWhiteSpaces(x);
-            rc = x;
+            rc = std::string(str);
             break;
         }
     } while (false);
@@ -380,39 +376,26 @@ std::optional<std::string> ATParser::getText(std::string_view ignore)
 
 std::optional<std::tuple<datetime_t, bool, bool>> ATParser::evaluateGNSSTime(std::string_view item)
 {
+    using namespace decoder;
     std::optional<std::tuple<datetime_t, bool, bool>> rc = std::nullopt;
-    std::string tm;
-    int32_t fix;
-    int32_t stat;
     datetime_t tmx;
-    for (auto xx : _answer)
+    for (const auto &xx : _answer)
     {
-        if (findInsensitiveStr((std::string_view)xx, item) == 0)
+        if (findInsensitiveStr(xx, item) != 0)
+            continue;
+
+        // run status, fix status, yyyyMMddhhmmss.sss
+        auto values = decode<Int, Int, Text>(valueOf(xx));
+        if (!values)
+            continue;
+
+        auto [stat, fix, tm] = *values;
+        memset(&tmx, 0, sizeof(tmx));
+        if (number(tm, 0, 4, tmx.year) && number(tm, 4, 2, tmx.month) && number(tm, 6, 2, tmx.day) &&
+            number(tm, 8, 2, tmx.hour) && number(tm, 10, 2, tmx.min) && number(tm, 12, 2, tmx.sec))
         {
-            auto kv = getKeyValue(xx);
-            if (kv.first.empty() || kv.second.empty())
-                continue;
-            eatWhiteSpaces(kv.second);
-            tm.resize(kv.second.length() + 1);
-            fix = 0;
-            stat = 0;
-            auto count = std::sscanf(kv.second.c_str(), "%d,%d,%[^,]",
-                                     &stat, &fix, &tm[0]);
-
-            if (count == 3 && tm.length() >= 14)
-            {
-
-                memset(&tmx, 0, sizeof(tmx));
-
-                tmx.year = std::stoi(tm.substr(0, 4));
-                tmx.month = std::stoi(tm.substr(4, 2));
-                tmx.day = std::stoi(tm.substr(6, 2));
-                tmx.hour = std::stoi(tm.substr(8, 2));
-                tmx.min = std::stoi(tm.substr(10, 2));
-                tmx.sec = std::stoi(tm.substr(12, 2));
-                TimeUtils::updateDayOfWeek(tmx);
-                rc = std::make_tuple(tmx, fix ? true : false, stat ? true : false);
-            }
+            TimeUtils::updateDayOfWeek(tmx);
+            rc = std::make_tuple(tmx, fix ? true : false, stat ? true : false);
         }
     }
 
@@ -421,29 +404,22 @@ std::optional<std::tuple<datetime_t, bool, bool>> ATParser::evaluateGNSSTime(std
 
 std::optional<std::tuple<std::string, std::string, std::string>> ATParser::evaluateSMS(std::string_view item)
 {
+    using namespace decoder;
     std::optional<std::tuple<std::string, std::string, std::string>> rc = std::nullopt;
-    std::string tm;
-    std::string id;
-    std::string aux1;
-    std::string aux2;
-    for (auto xx : _answer)
+    std::optional<Decoded<Quoted, Quoted, Quoted, Quoted>> header;
+    for (const auto &xx : _answer)
     {
-        if (findInsensitiveStr((std::string_view)xx, item) == 0)
+        if (findInsensitiveStr(xx, item) == 0)
         {
-            auto kv = getKeyValue(xx);
-            if (kv.first.empty() || kv.second.empty())
-                continue;
-            eatWhiteSpaces(kv.second);
-            tm.resize(kv.second.length() + 1);
-            id.resize(kv.second.length() + 1);
-            aux1.resize(kv.second.length() + 1);
-            aux2.resize(kv.second.length() + 1);
-            auto count = std::sscanf(kv.second.c_str(), "%[^,],%[^,],%[^,],%s",
-                                     &aux1[0], &id[0], &aux2[0], &tm[0]);
+            // stat, caller id, alpha, timestamp
+            header = decode<Quoted, Quoted, Quoted, Quoted>(valueOf(xx));
         }
-        else if (!tm.empty() && !id.empty())
+        else if (header)
         {
-            rc = std::make_tuple(betweenMarks(id), betweenMarks(tm), xx);
+            auto [stat, id, alpha, tm] = *header;
+            if (tm.empty() || id.empty())
+                break;
+            rc = std::make_tuple(std::string(id), std::string(tm), std::string(xx));
             break;
         }
     }
@@ -453,186 +429,64 @@ std::optional<std::tuple<std::string, std::string, std::string>> ATParser::evalu
 
 std::optional<std::tuple<int32_t, int32_t>> ATParser::evalueate2ComaValues()
 {
-    int32_t a = 0, b = 0;
-    std::optional<std::tuple<int32_t, int32_t>> rc = std::nullopt;
-    do
-    {
-        if (_answer.empty())
-            break;
-
-        for (auto x : _answer)
-        {
-            auto kv = getKeyValue(x);
-
-            if (kv.first.empty() || kv.second.empty())
-                continue;
-            eatWhiteSpaces(kv.second);
-
-            auto count = std::sscanf(kv.second.c_str(), "%d,%d",
-                                     &a, &b);
-
-            if (count != 2)
-                continue;
-            rc = std::make_tuple(a, b);
-            break;
-        }
-
-    } while (false);
-    return rc;
+    return decodeFirst<decoder::Int, decoder::Int>();
 }
 
 std::optional<std::tuple<std::string, int32_t, int32_t>> ATParser::evalueateTextAndTwoNumber()
 {
-    int32_t a = 0, b = 0;
-    std::string info;
     std::optional<std::tuple<std::string, int32_t, int32_t>> rc = std::nullopt;
-    do
+    if (auto values = decodeFirst<decoder::Quoted, decoder::Int, decoder::Int>())
     {
-        if (_answer.empty())
-            break;
-
-        for (auto x : _answer)
-        {
-
-            auto kv = getKeyValue(x);
-
-            if (kv.first.empty() || kv.second.empty())
-                continue;
-            eatWhiteSpaces(kv.second);
-
-            info.resize(kv.second.length() + 1);
-            auto count = std::sscanf(kv.second.c_str(), "%[^,],%d,%d",
-                                     &info[0], &a, &b);
-            if (count != 3)
-                continue;
-            rc = std::make_tuple(betweenMarks(info), a, b);
-            break;
-        }
-
-    } while (false);
+        auto [info, a, b] = *values;
+        rc = std::make_tuple(std::string(info), a, b);
+    }
     return rc;
 }
 
 std::optional<std::tuple<std::string, int32_t>> ATParser::evalueateTextAndNumber()
 {
-    int32_t a = 0;
-    std::string info;
     std::optional<std::tuple<std::string, int32_t>> rc = std::nullopt;
-    do
+    if (auto values = decodeFirst<decoder::Quoted, decoder::Int>())
     {
-        if (_answer.empty())
-            break;
-
-        for (auto x : _answer)
-        {
-            auto kv = getKeyValue(x);
-
-            if (kv.first.empty() || kv.second.empty())
-                continue;
-            eatWhiteSpaces(kv.second);
-            info.resize(kv.second.length() + 1);
-            auto count = std::sscanf(kv.second.c_str(), "%[^,],%d",
-                                     &info[0], &a);
-            if (count != 2)
-                continue;
-            rc = std::make_tuple(betweenMarks(info), a);
-            break;
-        }
-
-    } while (false);
+        auto [info, a] = *values;
+        rc = std::make_tuple(std::string(info), a);
+    }
     return rc;
 }
 
 std::optional<std::string> ATParser::evalueateText()
 {
-    int32_t a = 0;
     std::optional<std::string> rc = std::nullopt;
-    do
+    for (const auto &x : _answer)
     {
-        if (_answer.empty())
-            break;
-
-        for (auto x : _answer)
-        {
-            auto kv = getKeyValue(x);
-            if (kv.first.empty() || kv.second.empty())
-                continue;
-            eatWhiteSpaces(kv.second);
-            auto str = betweenMarks(kv.second);
-            if (str.empty())
-                continue;
-            rc = str;
-            break;
-        }
-
-    } while (false);
+        auto str = betweenMarks(decoder::valueOf(x));
+        if (str.empty())
+            continue;
+        rc = std::string(str);
+        break;
+    }
     return rc;
 }
 
 std::optional<std::tuple<int32_t, int32_t, std::string>> ATParser::evalueate2ComaValuesString()
 {
-    int32_t a = 0, b = 0;
-    std::string str;
     std::optional<std::tuple<int32_t, int32_t, std::string>> rc = std::nullopt;
-    do
+    if (auto values = decodeFirst<decoder::Int, decoder::Int, decoder::Quoted>())
     {
-        if (_answer.empty())
-            break;
-
-        for (auto x : _answer)
-        {
-            auto kv = getKeyValue(x);
-            if (kv.first.empty() || kv.second.empty())
-                continue;
-            eatWhiteSpaces(kv.second);
-
-            str.resize(kv.second.size() + 1);
-
-            auto count = std::sscanf(kv.second.c_str(), "%d,%d,%s",
-                                     &a, &b, &str[0]);
-            if (count != 3)
-                continue;
-
-            rc = std::make_tuple(a, b, betweenMarks(str));
-            break;
-        }
-
-    } while (false);
+        auto [a, b, str] = *values;
+        rc = std::make_tuple(a, b, std::string(str));
+    }
     return rc;
 }
 
 std::optional<std::tuple<std::string, int32_t, std::string>> ATParser::evalueateTextNumberTxt()
 {
-    int32_t a = 0, b = 0;
-    std::string str1;
-    std::string str2;
     std::optional<std::tuple<std::string, int32_t, std::string>> rc = std::nullopt;
-    do
+    if (auto values = decodeFirst<decoder::Quoted, decoder::Int, decoder::Quoted>())
     {
-        if (_answer.empty())
-            break;
-
-        for (auto x : _answer)
-        {
-            auto kv = getKeyValue(x);
-            if (kv.first.empty() || kv.second.empty())
-                continue;
-            eatWhiteSpaces(kv.second);
-
-            str1.resize(kv.second.size() + 1);
-            str2.resize(kv.second.size() + 1);
-
-            auto count = std::sscanf(kv.second.c_str(), "%[^,],%d,%s",
-                                     &str1[0], &b, &str2[0]);
-
-            if (count != 3)
-                continue;
-
-            rc = std::make_tuple(betweenMarks(str1), b, betweenMarks(str2));
-            break;
-        }
-
-    } while (false);
+        auto [str1, b, str2] = *values;
+        rc = std::make_tuple(std::string(str1), b, std::string(str2));
+    }
     return rc;
 }
 
@@ -641,16 +495,13 @@ bool ATParser::isStatusExists(ResponseStatus status) const
     bool rc = false;
     do
     {
-
-        auto part = std::find_if(ATStatus.begin(), ATStatus.end(), [status](const auto &item)
-                                 { return (status == item.second); });
-
-        if (part == ATStatus.end())
+        auto token = ATStatusTrie.token(status);
+        if (token.empty())
             break;
 
-        for (auto a : _answer)
+        for (const auto &a : _answer)
         {
-            if (containString(a, part->first))
+            if (containString(a, token))
             {
                 rc = true;
                 break;
@@ -663,27 +514,19 @@ bool ATParser::isStatusExists(ResponseStatus status) const
 std::optional<datetime_t> ATParser::evalueateDateTime()
 {
     std::optional<datetime_t> rc = std::nullopt;
-    bool minussgn = false;
-    datetime_t r;
-    uint32_t day = 0, month = 0, year = 0, hour = 0, min = 0, sec = 0, zone = 0;
-
-    memset(&r, 0, sizeof(datetime_t));
 
     do
     {
         if (_answer.empty())
             break;
-        std::string datestr;
-        for (auto a : _answer)
+        std::string_view datestr;
+        for (const auto &a : _answer)
         {
             datestr = betweenMarks(a);
             if (!datestr.empty())
                 break;
         }
 
-        if (datestr.empty())
-            break;
-
         if (datestr.size() < 20)
             break;
 
@@ -695,24 +538,27 @@ std::optional<datetime_t> ATParser::evalueateDateTime()
 
 std::optional<datetime_t> ATParser::breakTime(std::string_view datestr)
 {
+    using namespace decoder;
     std::optional<datetime_t> rc = std::nullopt;
-    bool minussgn = false;
     datetime_t r;
-    int count = 0;
     uint32_t day = 0, month = 0, year = 0, hour = 0, min = 0, sec = 0, zone = 0;
 
     do
     {
         // yy/MM/dd,hh:mm:ss±zz   like "23/03/04,08:22:23+04"
-        auto count = std::sscanf(datestr.data(), "%u/%u/%u,%u:%u:%u+%u",
-                                 &year, &month, &day, &hour, &min, &sec, &zone);
-        if (count != 7)
-        {
-            minussgn = true;
-            count = std::sscanf(datestr.data(), "%u/%u/%u,%u:%u:%u-%u",
-                                &year, &month, &day, &hour, &min, &sec, &zone);
-        }
-        if (count != 7)
+        if (!(number(datestr, year) && expect(datestr, '/') &&
+              number(datestr, month) && expect(datestr, '/') &&
+              number(datestr, day) && expect(datestr, ',') &&
+              number(datestr, hour) && expect(datestr, ':') &&
+              number(datestr, min) && expect(datestr, ':') &&
+              number(datestr, sec)))
+            break;
+
+        bool minussgn = expect(datestr, '-');
+        if (!minussgn && !expect(datestr, '+'))
+            break;
+
+        if (!number(datestr, zone))
             break;
 
         auto unxtm = TimeUtils::makeUnixTime(2000 + year, month, day, hour, min, sec);
@@ -18,13 +18,24 @@
 #include <optional>
 #include "pico/util/datetime.h"
 #include "at_enums.h"
+#include "line_arena.h"
+#include "at_matcher.h"
+#include "at_decoder.h"
 
 namespace gsm {
 
 class ATParser
 {
+    static constexpr uint32_t _maxLinesResponse{10};
+    static constexpr uint32_t _lineReserve{128};
 
 public:
+    /**
+     * @brief response lines, views into the parser arena. Valid until the next init()
+     *
+     */
+    using Responses = LineArena<_maxLinesResponse + 1, _maxLinesResponse * _lineReserve>;
+
     /**
      * @brief initialize parser
      *
@@ -94,11 +105,11 @@ public:
     }
 
     /**
-     * @brief Gets vector of response lines
+     * @brief Gets response lines
      *
-     * @return Responses
+     * @return const Responses&
      */
-    Responses getResponses() const
+    const Responses &getResponses() const
     {
         return _answer;
     }
@@ -124,6 +135,32 @@ public:
      */
     bool isStatusExists(ResponseStatus status) const;
 
+    /**
+     * @brief decodes the value of the first response line matching the schema, format: key: values
+     * e.g. decodeFirst<decoder::Quoted, decoder::Int>() for +CPMS: "SM",2
+     *
+     * @tparam F - schema, decoder::Int, decoder::Quoted, decoder::Text
+     * @param key - required line key, empty - any line
+     * @return std::optional<Decoded<F...>> - views into the response lines
+     */
+    template <typename... F>
+    std::optional<Decoded<F...>> decodeFirst(std::string_view key = ""sv) const
+    {
+        std::optional<Decoded<F...>> rc = std::nullopt;
+        for (const auto &x : _answer)
+        {
+            if (!key.empty() && !startsWith(x, key))
+                continue;
+            auto value = decoder::valueOf(x);
+            if (value.empty())
+                continue;
+            rc = decode<F...>(value);
+            if (rc)
+                break;
+        }
+        return rc;
+    }
+
     /**
      * @brief searches the answers for a chain in the format: "string",number1,number2
      *
@@ -231,14 +268,31 @@ public:
     KeyValue getKeyValue(std::string_view input);
 
 private:
-    static constexpr uint32_t _maxLinesResponse{10};
-
     /**
      * @brief mark as invalid contnet and reinit parser
      *
      */
     void invalidContnet();
 
+    /**
+     * @brief append char to the open line and advance the status matcher
+     *
+     * @param inp
+     */
+    void append(char inp);
+
+    /**
+     * @brief drop the open line, restart the status matcher
+     *
+     */
+    void resetLine();
+
+    /**
+     * @brief store the open line as a response line, restart the status matcher
+     *
+     */
+    void commitLine();
+
     /**
      * @brief parse query
      *
@@ -295,9 +349,9 @@ private:
      *
      * @param strValue string
      * @param mark - mark
-     * @return std::string
+     * @return std::string_view
      */
-    std::string betweenMarks(std::string_view strValue, std::string_view mark = "\"");
+    std::string_view betweenMarks(std::string_view strValue, std::string_view mark = "\"");
 
     /**
      * @brief exceptions in parsing, such as the beginning of an SMS message
@@ -307,8 +361,9 @@ private:
 
     std::string _query;                                   ///< query contnet
     std::string _queryParam;                              ///< query params
-    Responses _answer;                                    ///< vector of answers
-    std::string _buffer;                                  ///< parser buffer
+    Responses _answer;                                    ///< answers + open line (parser buffer)
+    AtStatusMatcher _matcher;                             ///< status tokens matcher of the open line
+    uint8_t _quotes{0};                                   ///< quotes in the open line
     QueryType _queryType{QueryType::unknown};             ///< query type
     ParseCode _flow{ParseCode::qBegin};                   ///< processing sentence type
     ResponseStatus _status{ResponseStatus::unknown};      ///< response status
@@ -0,0 +1,119 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   at_trace.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+#include <cstddef>
+#include <algorithm>
+#include <string_view>
+#include <memory.h>
+
+namespace gsm {
+
+/**
+ * @brief direction of the traced data
+ *
+ */
+enum class TraceDir : uint8_t
+{
+    tx,     ///< driver -> modem
+    rx      ///< modem -> driver
+};
+
+/**
+ * @brief one traced run of bytes, a longer run is split into more records
+ *
+ */
+struct TraceRecord
+{
+    static constexpr std::size_t _capacity{54};
+
+    uint64_t _us{0};            ///< timestamp [us]
+    TraceDir _dir{TraceDir::tx};
+    uint8_t _length{0};
+    char _data[_capacity];
+
+    std::string_view data() const { return std::string_view(_data, _length); }
+};
+
+/**
+ * @brief RAM ring of the AT traffic, the oldest records are overwritten.
+ * Recording is a copy into a fixed slot, no allocation, no formatting.
+ * Private content (numbers, SMS texts) is masked by '*' unless capturePrivate is enabled.
+ * Single writer (the GSM driver), read it from the same task.
+ *
+ * @tparam Records - number of records, power of two
+ */
+template <std::size_t Records>
+class AtTrace
+{
+    static_assert(Records != 0 && (Records & (Records - 1)) == 0, "trace size must be power of two");
+
+public:
+    /**
+     * @brief store the run of bytes
+     *
+     * @param dir
+     * @param us - timestamp
+     * @param data
+     * @param keep - private content behind the first 'keep' characters, the line ends are kept
+     */
+    void record(TraceDir dir, uint64_t us, std::string_view data, std::size_t keep = std::string_view::npos)
+    {
+        if (!_enabled)
+            return;
+
+        if (_private)
+            keep = std::string_view::npos;
+
+        while (!data.empty())
+        {
+            auto &r = _records[_head++ & (Records - 1)];
+            r._us = us;
+            r._dir = dir;
+            r._length = (uint8_t)std::min(data.size(), TraceRecord::_capacity);
+            memcpy(r._data, data.data(), r._length);
+            for (std::size_t i = std::min(keep, (std::size_t)r._length); i < r._length; i++)
+            {
+                if (r._data[i] != '\r' && r._data[i] != '\n')
+                    r._data[i] = '*';
+            }
+            keep -= std::min(keep, (std::size_t)r._length);
+            data.remove_prefix(r._length);
+        }
+    }
+
+    /**
+     * @brief visits the stored records from the oldest one
+     *
+     * @tparam F - void(const TraceRecord &)
+     * @param f
+     */
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (auto i = _head - size(); i != _head; i++)
+            f(_records[i & (Records - 1)]);
+    }
+
+    std::size_t size() const { return (_head < Records) ? _head : Records; }
+    uint32_t overwritten() const { return (_head > Records) ? _head - Records : 0; }
+    void clear() { _head = 0; }
+    void enable(bool enable) { _enabled = enable; }
+    bool isEnabled() const { return _enabled; }
+    void capturePrivate(bool enable) { _private = enable; }
+    bool isCapturingPrivate() const { return _private; }
+
+private:
+    TraceRecord _records[Records];
+    uint32_t _head{0};          ///< records written since clear
+    bool _enabled{true};
+    bool _private{false};       ///< the private content is not masked
+};
+
+} // namespace gsm
@@ -6,8 +6,12 @@
 /// @author Petr Vanek
 
 #include <memory.h>
+#include <memory>
+#include <algorithm>
 #include "gsm.h"
 #include "gsm_commands.h"
+#include "sms_pdu.h"
+#include "../src-utils/str_comparators.h"
 
 namespace gsm
 {
@@ -29,31 +33,33 @@ namespace gsm
 				break;
 
 			callbck(GsmInfoState::hwinit);
+			_session = {};
+			_boot = 0;
 			_serial->hardwareInit();
 			callbck(GsmInfoState::wait);
-			_serial->delay(5000);
 
-			while (true)
+			// running or just starting modem answers within the boot time, otherwise it is switched on
+			bool alive = waitAlive(_bootWait);
+			for (uint32_t i = 0; !alive && i < _powerAttempts; i++)
 			{
 				callbck(GsmInfoState::ping);
-				if (ping())
-				{
-					callbck(GsmInfoState::ping);
-					eatSerial(_defaultWaitRx);
-					callbck(GsmInfoState::ping);
-					if (ping() && ping())
-					{
-						callbck(GsmInfoState::ping);
-						rc = echoOff();
-						break;
-					}
-				}
-				callbck(GsmInfoState::ping);
+				_session = {};
+				_boot = 0;
 				_serial->modemInit();
-				callbck(GsmInfoState::ping);
-				_serial->delay(2000);
+				alive = waitAlive(_bootWait);
 			}
 
+			// no power or a dead modem, reported by the caller
+			if (!alive)
+				break;
+
+			callbck(GsmInfoState::ping);
+			rc = echoOff();
+
+			// SIM and SMS readiness, no longer than the modem needs
+			waitReady(_readyWait);
+			callbck(GsmInfoState::ping);
+
 			if (withGnss)
 			{
 				callbck(GsmInfoState::gnss);
@@ -64,6 +70,144 @@ namespace gsm
 		return rc;
 	}
 
+	RecoveryReport GSM::recover(bool withGnss)
+	{
+		auto registered = [](std::optional<uint8_t> stat)
+		{
+			// home or roaming
+			return stat.has_value() && (stat.value() == 1 || stat.value() == 5);
+		};
+
+		RecoveryReport rc;
+		auto t = _serial->getus();
+		_recoveries++;
+
+		do
+		{
+			// pending requests would fail on the same problem
+			cancelRequests();
+
+			// 1. resync - lost line, e.g. the modem was busy
+			if (!waitAlive(_resyncWait))
+			{
+				// deaf modem, nothing cheaper than the power cycle
+				rc._tier = powerCycle(false, withGnss) ? RecoveryTier::powerCycle : RecoveryTier::failed;
+				break;
+			}
+
+			rc._tier = RecoveryTier::resync;
+			if (registered(isRegistered()))
+				break;
+
+			// 2. radio off / on
+			rc._tier = RecoveryTier::radio;
+			if (flightMode() && phoneMode() && registered(waitRegistered(_recoveryRegistration)))
+				break;
+
+			// 3. automatic network selection
+			rc._tier = RecoveryTier::registration;
+			if (sendAndRead(gsm_cmd::C_ATCOPS0, ResponseStatus::ok, _defaultWaitRx) &&
+				registered(waitRegistered(_recoveryRegistration)))
+				break;
+
+			// 4. power cycle
+			rc._tier = powerCycle(true, withGnss) ? RecoveryTier::powerCycle : RecoveryTier::failed;
+
+		} while (false);
+
+		rc._elapsedMs = (uint32_t)((_serial->getus() - t) / 1000);
+		_lastRecovery = rc;
+		return rc;
+	}
+
+	bool GSM::powerCycle(bool responsive, bool withGnss)
+	{
+		_session = {};
+		_boot = 0;
+
+		// the power key toggles, the answering modem is switched off by the command
+		if (!(responsive && sendAndRead(gsm_cmd::C_ATCPOWD, ResponseStatus::powerdown, _defaultWaitRx)))
+			_serial->modemInit();
+		_serial->delay(_powerDownWait);
+
+		// one toggle to power on, init() waits for the boot
+		_serial->modemInit();
+		return init(withGnss);
+	}
+
+	void GSM::cancelRequests()
+	{
+		if (_state != EngineState::idle)
+			finishRequest(false);
+
+		AtRequest request;
+		while (_requests.pop(request))
+		{
+			if (!request._callback)
+				continue;
+			_inCallback = true;
+			request._callback(false, _parser);
+			_inCallback = false;
+		}
+
+		// partial line of the cancelled response
+		_line.clear();
+		_lineComplete = true;
+	}
+
+	bool GSM::waitAlive(uint32_t maxWait)
+	{
+		bool rc = false;
+		auto t = _serial->getus();
+		while ((_serial->getus() - t) < maxWait * 1000ull)
+		{
+			if (_callback)
+				_callback(GsmInfoState::ping);
+
+			// two answers in a row, the autobaud is settled
+			if (ping() && ping())
+			{
+				rc = true;
+				break;
+			}
+
+			// boot messages, e.g. RDY
+			eatSerial(_bootPoll);
+		}
+		return rc;
+	}
+
+	bool GSM::waitReady(uint32_t maxWait)
+	{
+		auto ready = [this]()
+		{
+			// fresh start: SIM + SMS Ready URCs, modem started before: SIM is enough
+			return (_boot & ModemBoot::cpin) && (!(_boot & ModemBoot::rdy) || (_boot & ModemBoot::smsReady));
+		};
+
+		auto t = _serial->getus();
+		while (!ready() && !(_boot & ModemBoot::simError))
+		{
+			auto elapsed = (uint32_t)((_serial->getus() - t) / 1000);
+			if (elapsed >= maxWait)
+				break;
+
+			if (_boot & ModemBoot::rdy)
+			{
+				// the boot URCs follow
+				eatSerial(maxWait - elapsed, ModemBoot::cpin | ModemBoot::smsReady);
+			}
+			else
+			{
+				// the URCs were missed, the answer is observed as +CPIN: ...
+				if (!sendAndRead(gsm_cmd::C_ATCPIN, ResponseStatus::ok, _defaultWaitRx))
+					_serial->delay(_bootPoll);
+			}
+		}
+
+		return ready();
+	}
+
 	ResponseStatus GSM::checkStatus(uint32_t maxWait)
 	{
 		ResponseStatus rc = ResponseStatus::unknown;
@@ -72,6 +216,7 @@ namespace gsm
 		_lastStorage.clear();
 		_lastMessageNumber = 0;
 		_lastNumber.clear();
+		_lastSms.reset();
 
 		do
 		{
@@ -81,7 +226,40 @@ namespace gsm
 			_parser.init(ParseCode::aBegin);
 			_parser.withPrefferedTag(ResponseStatus::unknown);
 
-			if (!readLine(maxWait))
+			SmsLine sms;
+			if (_directSms.pop(sms))
+			{
+				// "+CMT: "+420123456789","","23/03/04,08:22:23+04"" + message text
+				std::string_view header(sms._data, sms._header);
+				auto values = decode<decoder::Quoted, decoder::Text, decoder::Quoted>(decoder::valueOf(header));
+				auto tmx = values.has_value() ? _parser.breakTime(std::get<2>(values.value())) : std::nullopt;
+				if (!values.has_value() || std::get<0>(values.value()).empty() || !tmx.has_value())
+				{
+					// the message is lost, the next ones go to the storage
+					storeSms();
+					break;
+				}
+
+				_lastNumber = std::get<0>(values.value());
+				_lastSms = std::make_tuple(std::string(sms._data + sms._header, sms._length - sms._header), _lastNumber, tmx.value());
+				rc = ResponseStatus::directsms;
+				break;
+			}
+
+			UrcLine urc;
+			if (_urc.pop(urc))
+			{
+				// received during a command, older than anything on the line
+				_line.assign(urc._data, urc._length);
+				_line += "\r\n";
+				_lineComplete = true;
+			}
+			else if (isBusy())
+			{
+				// the line belongs to the request in progress, see poll()
+				break;
+			}
+			else if (!readLine(maxWait))
 				break;
 
 			if (!_parser.parse(_line))
@@ -113,19 +291,93 @@ namespace gsm
 		return rc;
 	}
 
-	void GSM::eatSerial(uint32_t maxWait)
+	void GSM::eatSerial(uint32_t maxWait, uint8_t flags)
 	{
-		uint64_t t = 0;
+		auto t = _serial->getus();
 		while (true)
 		{
-			if ((_serial->getus() - t) > (maxWait * 1000))
+			if (flags && (_boot & flags) == flags)
+				break;
+
+			auto elapsed = (uint32_t)((_serial->getus() - t) / 1000);
+			if (elapsed >= maxWait)
 				break;
-			if (_callback) _callback(GsmInfoState::ping);
-			readLine(maxWait);
+
+			if (readLine(maxWait - elapsed))
+			{
+				if (_callback)
+					_callback(GsmInfoState::ping);
+
+				// events are kept for checkStatus
+				if (isUrc(_line))
+					pushUrc(_line);
+			}
 		}
 		return;
 	}
 
+	std::optional<uint8_t> GSM::waitRegistered(uint32_t maxWait)
+	{
+		std::optional<uint8_t> rc = std::nullopt;
+		auto t = _serial->getus();
+		while (true)
+		{
+			rc = isRegistered();
+
+			// home, denied, roaming - no change expected
+			if (rc.has_value() && (rc.value() == 1 || rc.value() == 3 || rc.value() == 5))
+				break;
+
+			auto elapsed = (uint32_t)((_serial->getus() - t) / 1000);
+			if (elapsed >= maxWait)
+				break;
+
+			eatSerial(std::min(_registrationPoll, maxWait - elapsed));
+		}
+		return rc;
+	}
+
+	std::optional<std::tuple<std::string, bool>> GSM::simSetup(bool callerId)
+	{
+		std::optional<std::tuple<std::string, bool>> rc = std::nullopt;
+		AtRequest request;
+		bool done = false;
+
+		// AT+CCID;+CPIN?;+CLIP=1
+		request._command = gsm_cmd::C_ATCCID;
+		request._command += ';';
+		request._command += gsm_cmd::C_ATCPIN.substr(gsm_cmd::C_AT.size());
+		request._command += ';';
+		request._command += (callerId ? gsm_cmd::C_CLIPON : gsm_cmd::C_CLIPOFF).substr(gsm_cmd::C_AT.size());
+		request._callback = [this, &rc, &done, callerId](bool success, ATParser &parser)
+		{
+			done = true;
+			if (!success)
+				return;
+
+			// ICCID is the only reply without a key
+			std::string iccid;
+			for (const auto &x : parser.getResponses())
+			{
+				auto line = decoder::trim(x);
+				if (!line.empty() && line.find(':') == std::string_view::npos &&
+					AtStatusMatcher().match(line).status() != ResponseStatus::ok)
+				{
+					iccid = line;
+					break;
+				}
+			}
+
+			auto pin = parser.compareResponseText(gsm_cmd::C_READY);
+			_session._callerId = callerId;
+			rc = std::make_tuple(iccid, pin.value_or(false));
+		};
+
+		if (!_inCallback && submit(request))
+			wait(done);
+		return rc;
+	}
+
 	bool GSM::flightMode()
 	{
 		return sendAndRead(gsm_cmd::C_ATCFUN0, ResponseStatus::ok, _defaultWaitRx);
@@ -133,31 +385,37 @@ namespace gsm
 
 	bool GSM::phoneMode()
 	{
+		_boot &= ~ModemBoot::cfun;
 		auto rc = sendAndRead(gsm_cmd::C_ATCFUN1, ResponseStatus::ok, _defaultWaitRx);
 		if (rc)
 		{
 			// eat like this
-			// RDY
 			// +CFUN: 1
+			// +CPIN: READY
 			// ..
-			eatSerial(2000);
+			eatSerial(2000, ModemBoot::cfun);
 		}
 		return rc;
 	}
 
 	bool GSM::echoOff()
 	{
-		auto rc = sendAndRead(gsm_cmd::C_ATE0, ResponseStatus::ok, _defaultWaitRx);
-		if (rc)
-			_echo = false;
-		return rc;
+		return apply(_session._echo, false, gsm_cmd::C_ATE0);
 	}
 
 	bool GSM::echoOn()
 	{
-		auto rc = sendAndRead(gsm_cmd::C_ATE1, ResponseStatus::ok, _defaultWaitRx);
-		if (rc)
-			_echo = true;
+		return apply(_session._echo, true, gsm_cmd::C_ATE1);
+	}
+
+	bool GSM::apply(std::optional<bool> &state, bool value, std::string_view command)
+	{
+		// already applied in this modem session
+		if (state == value)
+			return true;
+
+		auto rc = sendAndRead(command, ResponseStatus::ok, _defaultWaitRx);
+		state = rc ? std::optional<bool>(value) : std::nullopt;
 		return rc;
 	}
 
@@ -168,7 +426,7 @@ namespace gsm
 
 	bool GSM::setCallerID(bool enable)
 	{
-		return sendAndRead(enable ? gsm_cmd::C_CLIPON : gsm_cmd::C_CLIPOFF, ResponseStatus::ok, _defaultWaitRx);
+		return apply(_session._callerId, enable, enable ? gsm_cmd::C_CLIPON : gsm_cmd::C_CLIPOFF);
 	}
 
 	void GSM::whitInfoCallback(GSMInfoCallback clb)
@@ -251,22 +509,154 @@ namespace gsm
 	std::optional<std::string> GSM::getOperator()
 	{
 		std::optional<std::string> rc = std::nullopt;
-		do
-		{
-			if (!sendAndRead(gsm_cmd::C_ATCOPS, ResponseStatus::ok, _defaultWaitRx))
-				break;
+		bool done = false;
+		if (!_inCallback && getOperator([&rc, &done](std::optional<std::string> result)
+						{
+							rc = result;
+							done = true; }))
+			wait(done);
+		return rc;
+	}
 
-			auto val = _parser.evalueate2ComaValuesString();
-			if (val.has_value())
+	bool GSM::getOperator(ResultCallback<std::string> clb)
+	{
+		AtRequest request;
+		request._command = gsm_cmd::C_ATCOPS;
+		request._callback = [clb](bool success, ATParser &parser)
+		{
+			std::optional<std::string> rc = std::nullopt;
+			do
 			{
-				auto [a, b, str] = val.value();
-				rc = str;
-			}
+				if (!success)
+					break;
 
-		} while (false);
+				auto val = parser.evalueate2ComaValuesString();
+				if (val.has_value())
+				{
+					auto [a, b, str] = val.value();
+					rc = str;
+				}
+
+			} while (false);
+
+			if (clb)
+				clb(rc);
+		};
+		return submit(request);
+	}
+
+	std::optional<Telemetry> GSM::telemetry(uint8_t items)
+	{
+		std::optional<Telemetry> rc = std::nullopt;
+		bool done = false;
+		if (!_inCallback && telemetry(items, [&rc, &done](std::optional<Telemetry> result)
+					  {
+						  rc = result;
+						  done = true; }))
+			wait(done);
 		return rc;
 	}
 
+	bool GSM::telemetry(uint8_t items, ResultCallback<Telemetry> clb)
+	{
+		AtRequest request;
+
+		// one line, e.g. AT+CSQ;+CREG?;+COPS?;+CCLK?;+CPMS?;+CGNSINF
+		request._command = gsm_cmd::C_AT;
+		auto add = [&request, items](uint8_t item, std::string_view cmd)
+		{
+			if (!(items & item))
+				return;
+			if (request._command.size() > gsm_cmd::C_AT.size())
+				request._command += ';';
+			request._command += cmd.substr(gsm_cmd::C_AT.size());
+		};
+
+		add(Telemetry::signal, gsm_cmd::C_ATCSQ);
+		add(Telemetry::registration, gsm_cmd::C_ATCREG);
+		add(Telemetry::provider, gsm_cmd::C_ATCOPS);
+		add(Telemetry::rtc, gsm_cmd::C_ATCCLK);
+		add(Telemetry::storage, gsm_cmd::C_CATPMS);
+
+		// the modem stops the line at the first ERROR, AT+CGNSINF fails with GNSS off
+		add(Telemetry::gnss, gsm_cmd::C_CCGNSINF);
+
+		if (request._command.size() == gsm_cmd::C_AT.size())
+			return false;
+
+		// the RTC reading is timestamped by its line, not by the end of the whole response
+		auto rtcStamp = std::make_shared<uint64_t>(0);
+		if (items & Telemetry::rtc)
+		{
+			request._onLine = [this, rtcStamp](std::string_view line)
+			{
+				line = decoder::trim(line);
+				if (!line.empty() && line.front() == '+')
+					line.remove_prefix(1);
+				if (compareInsensitiveStr(line.substr(0, gsm_cmd::C_CCLK.size()), gsm_cmd::C_CCLK))
+					*rtcStamp = _serial->getus();
+				return false;
+			};
+		}
+
+		request._callback = [this, items, clb, rtcStamp](bool success, ATParser &parser)
+		{
+			using namespace decoder;
+			std::optional<Telemetry> rc = std::nullopt;
+			do
+			{
+				// every reply is found by its own key, a failed line keeps the replies before the error
+				Telemetry tm;
+				if (items & Telemetry::signal)
+				{
+					if (auto val = parser.decodeFirst<Int, Int>(gsm_cmd::C_CSQ))
+						tm._signal = (uint8_t)std::get<0>(*val);
+				}
+
+				if (items & Telemetry::registration)
+				{
+					if (auto val = parser.decodeFirst<Int, Int>(gsm_cmd::C_CREG))
+						tm._registration = (uint8_t)std::get<1>(*val);
+				}
+
+				if (items & Telemetry::provider)
+				{
+					if (auto val = parser.decodeFirst<Int, Int, Quoted>(gsm_cmd::C_COPS))
+						tm._operator = std::string(std::get<2>(*val));
+				}
+
+				if (items & Telemetry::rtc)
+				{
+					if (auto val = parser.decodeFirst<Quoted>(gsm_cmd::C_CCLK))
+						tm._rtc = parser.breakTime(std::get<0>(*val));
+					tm._sent = _started;
+					tm._rtcStamp = *rtcStamp;
+				}
+
+				if (items & Telemetry::gnss)
+				{
+					tm._gnss = parser.evaluateGNSSTime(gsm_cmd::C_CGNSINFA);
+				}
+
+				if (items & Telemetry::storage)
+				{
+					if (auto val = parser.decodeFirst<Quoted, Int, Int>(gsm_cmd::C_CPMS))
+						tm._storage = std::make_tuple((uint32_t)std::get<1>(*val), (uint32_t)std::get<2>(*val));
+				}
+
+				// failed only if nothing is answered, e.g. timeout
+				if (!success && !tm._signal && !tm._registration && !tm._operator && !tm._rtc && !tm._gnss && !tm._storage)
+					break;
+
+				rc = tm;
+			} while (false);
+
+			if (clb)
+				clb(rc);
+		};
+		return submit(request);
+	}
+
 	std::optional<std::tuple<datetime_t, bool, bool>> GSM::gnssInfo()
 	{
 		std::optional<std::tuple<datetime_t, bool, bool>> rc = std::nullopt;
@@ -304,101 +694,241 @@ namespace gsm
 	std::optional<std::tuple<std::string, std::string, datetime_t>> GSM::readSMS(uint32_t index)
 	{
 		std::optional<std::tuple<std::string, std::string, datetime_t>> rc = std::nullopt;
-		do
+		bool done = false;
+		if (!_inCallback && readSMS(index, [&rc, &done](std::optional<std::tuple<std::string, std::string, datetime_t>> result)
+					{
+						rc = result;
+						done = true; }))
+			wait(done);
+		return rc;
+	}
+
+	bool GSM::readSMS(uint32_t index, ResultCallback<std::tuple<std::string, std::string, datetime_t>> clb)
+	{
+		AtRequest request;
+		request._command = gsm_cmd::C_CMGR000;
+		request._command += std::to_string(index);
+		request._textMode = true;
+		request._callback = [clb](bool success, ATParser &parser)
 		{
-			if (!sendAndRead(gsm_cmd::C_ATCMGFON, ResponseStatus::ok, _defaultWaitRx))
-				break;
+			std::optional<std::tuple<std::string, std::string, datetime_t>> rc = std::nullopt;
+			do
+			{
+				if (!success)
+					break;
 
-			std::string cmd;
-			cmd = gsm_cmd::C_CMGR000;
-			cmd += std::to_string(index);
-			if (!sendAndRead(cmd, ResponseStatus::ok, _defaultWaitRx))
-				break;
+				auto sms = parser.evaluateSMS(gsm_cmd::C_CMGR);
+				if (!sms.has_value())
+					break;
 
-			auto sms = _parser.evaluateSMS(gsm_cmd::C_CMGR);
-			if (sms.has_value())
-			{
 				auto [id, tm, msg] = sms.value();
-				auto tmx = _parser.breakTime(tm);
+				auto tmx = parser.breakTime(tm);
 				if (!tmx.has_value())
 					break;
 
 				rc = std::make_tuple(msg, id, tmx.value());
-			}
+			} while (false);
 
-		} while (false);
+			if (clb)
+				clb(rc);
+		};
+		return submit(request);
+	}
+
+	std::optional<std::vector<SmsMessage>> GSM::drainInbox()
+	{
+		std::optional<std::vector<SmsMessage>> rc = std::nullopt;
+		bool done = false;
+		if (!_inCallback && drainInbox([&rc, &done](std::optional<std::vector<SmsMessage>> result)
+					   {
+						rc = std::move(result);
+						done = true; }))
+			wait(done);
 		return rc;
 	}
 
-	bool GSM::delAllSMS()
+	bool GSM::drainInbox(ResultCallback<std::vector<SmsMessage>> clb)
 	{
-		auto rc = false;
-		do
+		// shared by the line handler and the completion
+		struct Drain
 		{
-			if (!sendAndRead(gsm_cmd::C_ATCMGFON, ResponseStatus::ok, _defaultWaitRx))
-				break;
+			std::vector<SmsMessage> _inbox;         ///< complete messages
+			std::vector<uint32_t> _indexes;         ///< storage indexes of the listed messages, deleted
+			std::optional<SmsMessage> _message;     ///< the text is being received
+			uint32_t _index{0};                     ///< storage index of _message
+			bool _valid{false};                     ///< _message header decoded, not handed over before
+			std::size_t _expected{0};               ///< text length of the AT+CSDH=1 header, 0 - one line
+			std::size_t _received{0};               ///< received characters including the line ends
+		};
+		auto drain = std::make_shared<Drain>();
 
-			std::string cmd;
-			cmd = gsm_cmd::C_CMGD000;
-			cmd += "1,4";
-			if (!sendAndRead(cmd, ResponseStatus::ok, _defaultWaitRx))
-				break;
+		// the text length is in the header with AT+CSDH=1
+		AtRequest request;
+		request._command = gsm_cmd::C_CMGLALL;
+		if (_session._smsHeader != true)
+		{
+			request._command = gsm_cmd::C_CSDHON;
+			request._command += ';';
+			request._command += gsm_cmd::C_CMGLALL.substr(gsm_cmd::C_AT.size());
+		}
+		request._textMode = true;
+		request._onLine = [this, drain](std::string_view line)
+		{
+			if (drain->_message.has_value())
+			{
+				// the message text, the lines up to the length, one line without it
+				auto &text = std::get<0>(drain->_message.value());
+				if (drain->_received)
+					text += '\n';
+				text += line.substr(0, line.find_last_not_of("\r\n") + 1);
+				drain->_received += line.size();
+				if (drain->_received < drain->_expected)
+					return true;
+
+				// the broken and the already handed over messages are only deleted
+				if (drain->_valid)
+					drain->_inbox.push_back(std::move(drain->_message.value()));
+				drain->_indexes.push_back(drain->_index);
+				drain->_message.reset();
+				return true;
+			}
 
-			rc = true;
+			// +CMGL: 1,"REC UNREAD","+420123456789","","23/03/04,08:22:23+04",145,5 + message text
+			auto str = decoder::trim(line);
+			if (!str.empty() && str.front() == '+')
+				str.remove_prefix(1);
+			if (!compareInsensitiveStr(str.substr(0, gsm_cmd::C_CMGL.size()), gsm_cmd::C_CMGL))
+				return false;
+
+			auto values = decode<decoder::Int, decoder::Quoted, decoder::Quoted, decoder::Text, decoder::Quoted>(decoder::valueOf(str));
+			if (!values.has_value())
+				return false;
+
+			// the text is consumed even if the header is not valid, e.g. a stored outgoing message
+			auto [index, stat, id, alpha, tm] = values.value();
+			auto tmx = _parser.breakTime(tm);
+			auto full = decode<decoder::Int, decoder::Quoted, decoder::Quoted, decoder::Text, decoder::Quoted, decoder::Int, decoder::Int>(decoder::valueOf(str));
+			drain->_message = std::make_tuple(std::string(), std::string(id), tmx.value_or(datetime_t{}));
+			drain->_index = (uint32_t)index;
+			drain->_valid = !id.empty() && tmx.has_value() &&
+							std::find(_undeleted.begin(), _undeleted.end(), (uint32_t)index) == _undeleted.end();
+			drain->_expected = full.has_value() ? (std::size_t)std::max<int32_t>(0, std::get<6>(full.value())) : 0;
+			drain->_received = 0;
+			return true;
+		};
+		request._callback = [this, drain, clb](bool success, ATParser &)
+		{
+			std::optional<std::vector<SmsMessage>> rc = std::nullopt;
+			if (success)
+			{
+				// the listing has the whole storage, the failed deletes not listed are gone
+				_session._smsHeader = true;
+				_undeleted.clear();
+				deleteSMS(drain->_indexes);
+				rc = std::move(drain->_inbox);
+			}
 
-		} while (false);
-		return rc;
+			if (clb)
+				clb(std::move(rc));
+		};
+		return submit(request);
 	}
 
-	bool GSM::delSMS(uint32_t index)
+	void GSM::deleteSMS(const std::vector<uint32_t> &indexes)
 	{
-		bool rc = false;
-		do
+		// AT+CMGD=1;+CMGD=2 ..., a few messages per command line
+		for (std::size_t i = 0; i < indexes.size(); i += _maxDeletes)
 		{
-			if (!sendAndRead(gsm_cmd::C_ATCMGFON, ResponseStatus::ok, _defaultWaitRx))
-				break;
-
-			std::string cmd;
-			cmd = gsm_cmd::C_CMGD000;
-			cmd += std::to_string(index);
-			if (!sendAndRead(cmd, ResponseStatus::ok, _defaultWaitRx))
-				break;
-
-			rc = true;
+			std::vector<uint32_t> chunk(indexes.begin() + i, indexes.begin() + std::min(indexes.size(), i + _maxDeletes));
+			AtRequest del;
+			del._command = gsm_cmd::C_AT;
+			for (auto index : chunk)
+			{
+				if (del._command.size() > gsm_cmd::C_AT.size())
+					del._command += ';';
+				del._command += gsm_cmd::C_CMGD000.substr(gsm_cmd::C_AT.size());
+				del._command += std::to_string(index);
+			}
 
-		} while (false);
+			// the next drain deletes them again, not hands them over
+			del._callback = [this, chunk](bool success, ATParser &)
+			{
+				if (!success)
+					_undeleted.insert(_undeleted.end(), chunk.begin(), chunk.end());
+			};
+			if (!submit(del))
+				_undeleted.insert(_undeleted.end(), chunk.begin(), chunk.end());
+		}
+	}
 
-		return rc;
+	bool GSM::showSMSHeader(bool enable)
+	{
+		return apply(_session._smsHeader, enable, enable ? gsm_cmd::C_CSDHON : gsm_cmd::C_CSDHOFF);
 	}
 
-	bool GSM::sendSMS(std::string_view phoneNumber, std::string_view ascii7Text)
+	bool GSM::ensureTextMode(bool enable)
 	{
+		return apply(_session._textMode, enable, enable ? gsm_cmd::C_ATCMGFON : gsm_cmd::C_ATCMGFOFF);
+	}
 
+	bool GSM::directSMS(bool enable)
+	{
 		bool rc = false;
-		std::string message;
 		do
 		{
-			if (phoneNumber.empty())
+			// the +CMT header is decoded in the text mode, its length field ends the text
+			if (enable && !(ensureTextMode(true) && showSMSHeader(true)))
 				break;
 
-			if (ascii7Text.empty())
-				break;
+			rc = apply(_session._directSms, enable, enable ? gsm_cmd::C_CNMIDIRECT : gsm_cmd::C_CNMISTORE);
+		} while (false);
+		return rc;
+	}
 
-			if (!sendAndRead(gsm_cmd::C_ATCMGFON, ResponseStatus::ok, _defaultWaitRx))
-				break;
+	bool GSM::gnssStream(bool enable)
+	{
+		return apply(_session._gnssStream, enable, enable ? gsm_cmd::C_CGNSTSTON : gsm_cmd::C_CGNSTSTOFF);
+	}
 
-			message = gsm_cmd::C_ATCMGS;
-			message += "=\"";
-			message += phoneNumber;
-			message += "\"";
+	bool GSM::delAllSMS()
+	{
+		AtRequest request;
+		request._command = gsm_cmd::C_CMGD000;
+		request._command += "1,4";
+		request._textMode = true;
+		return execute(request);
+	}
+
+	bool GSM::delSMS(uint32_t index)
+	{
+		AtRequest request;
+		request._command = gsm_cmd::C_CMGD000;
+		request._command += std::to_string(index);
+		request._textMode = true;
+		return execute(request);
+	}
+
+	bool GSM::sendSMS(std::string_view phoneNumber, std::string_view ascii7Text)
+	{
 
-			if (!sendAndRead(message, ResponseStatus::smsready, _defaultWaitRx))
+		bool rc = false;
+		do
+		{
+			if (phoneNumber.empty())
 				break;
 
-			if (!sendData(ascii7Text, _maxWaitTx))
+			if (ascii7Text.empty())
 				break;
 
-			if (!sendAndRead(gsm_cmd::CTRLZCR, ResponseStatus::ok, _defaultWaitRx))
+			AtRequest request;
+			request._command = gsm_cmd::C_ATCMGS;
+			request._command += "=\"";
+			request._command += phoneNumber;
+			request._command += "\"";
+			request._payload = ascii7Text;
+			request._textMode = true;
+
+			if (!execute(request))
 				break;
 
 			rc = true;
@@ -410,20 +940,40 @@ namespace gsm
 	std::optional<uint8_t> GSM::qualitySignal()
 	{
 		std::optional<uint8_t> rc = std::nullopt;
-		do
-		{
-			if (!sendAndRead(gsm_cmd::C_ATCSQ, ResponseStatus::ok, _defaultWaitRx))
-				break;
+		bool done = false;
+		if (!_inCallback && qualitySignal([&rc, &done](std::optional<uint8_t> result)
+						  {
+							  rc = result;
+							  done = true; }))
+			wait(done);
+		return rc;
+	}
 
-			auto vals = _parser.evalueate2ComaValues();
-			if (vals.has_value())
+	bool GSM::qualitySignal(ResultCallback<uint8_t> clb)
+	{
+		AtRequest request;
+		request._command = gsm_cmd::C_ATCSQ;
+		request._callback = [clb](bool success, ATParser &parser)
+		{
+			std::optional<uint8_t> rc = std::nullopt;
+			do
 			{
-				auto [rssi, ber] = vals.value();
-				rc = rssi;
-			}
+				if (!success)
+					break;
 
-		} while (false);
-		return rc;
+				auto vals = parser.evalueate2ComaValues();
+				if (vals.has_value())
+				{
+					auto [rssi, ber] = vals.value();
+					rc = rssi;
+				}
+
+			} while (false);
+
+			if (clb)
+				clb(rc);
+		};
+		return submit(request);
 	}
 
 	std::optional<uint8_t> GSM::isRegistered()
@@ -475,127 +1025,675 @@ namespace gsm
 	}
 
 	bool GSM::sendAndRead(std::string_view command, ResponseStatus reqResStatus, uint32_t maxWait)
+	{
+		AtRequest request;
+		request._command = command;
+		request._status = reqResStatus;
+		request._maxWait = maxWait;
+		return execute(request);
+	}
+
+	bool GSM::execute(const AtRequest &request)
+	{
+		bool rc = false;
+		bool done = false;
+		AtRequest sync = request;
+		sync._callback = [&rc, &done](bool success, ATParser &)
+		{
+			rc = success;
+			done = true;
+		};
+
+		if (!_inCallback && submit(sync))
+			wait(done);
+
+		return rc;
+	}
+
+	void GSM::wait(const bool &done)
+	{
+		// the requests queued before are completed first, not from a request callback
+		while (!done && !_inCallback && isBusy())
+			poll(_defaultCheckModem);
+	}
+
+	bool GSM::submit(const AtRequest &request)
+	{
+		return _requests.push(request);
+	}
+
+	bool GSM::poll(uint32_t maxWait)
+	{
+		auto tt = _serial->getus();
+		while (true)
+		{
+			if (_state == EngineState::idle)
+			{
+				if (!startRequest())
+					break;
+				if (_state == EngineState::idle)
+					break; // failed to send
+			}
+
+			auto now = _serial->getus();
+			if (now >= _deadline)
+			{
+				// late reply would complete the next request, the line is resynchronized first
+				expire();
+				if (_state == EngineState::idle)
+					break;
+				continue;
+			}
+
+			// wait for the line at most to the poll limit or the request deadline
+			auto elapsed = now - tt;
+			uint64_t limit = (elapsed < maxWait * 1000ull) ? maxWait * 1000ull - elapsed : 0;
+			limit = std::min(limit, _deadline - now);
+
+			// the "> " prompt is not terminated by the end of line
+			if (!readLine((uint32_t)((limit + 999) / 1000), _state == EngineState::prompt || _state == EngineState::quiet))
+			{
+				if (_serial->getus() - tt >= maxWait * 1000ull)
+					break;
+				continue;
+			}
+
+			// a slow command is not a dead modem
+			_responsive = true;
+
+			if (_state == EngineState::response && _active._onLine)
+			{
+				// long responses (AT+CMGL) are evaluated line by line, the data lines (e.g. "RING"
+				// or "OK" in a message text) are neither events nor parsed
+				_inCallback = true;
+				auto data = _active._onLine(_line);
+				_inCallback = false;
+				if (data)
+					continue;
+			}
+
+			if (isUrc(_line))
+			{
+				// event, not a part of the response
+				pushUrc(_line);
+				continue;
+			}
+
+			if (_state == EngineState::quiet)
+			{
+				// the rest of the timed out reply, until nothing comes for a while
+				_deadline = _serial->getus() + _quietWait * 1000ull;
+				continue;
+			}
+
+			if (!_parser.parse(_line))
+			{
+				// do not wait for the deadline if the command failed
+				// the whole line, an "Error ..." text is not the final status
+				auto line = decoder::trim(_line);
+				if (compareInsensitiveStr(line, ATStatusTrie.token(ResponseStatus::error)) ||
+					compareInsensitiveStr(line.substr(0, gsm_cmd::C_CMEERROR.size()), gsm_cmd::C_CMEERROR) ||
+					compareInsensitiveStr(line.substr(0, gsm_cmd::C_CMSERROR.size()), gsm_cmd::C_CMSERROR))
+				{
+					if (_state == EngineState::resync)
+					{
+						// the late status of the timed out command, AT is still to answer
+						_parser.init(ParseCode::aBegin);
+						_parser.withPrefferedTag(ResponseStatus::ok);
+						continue;
+					}
+					if (_state == EngineState::setup)
+						_session._textMode.reset();
+					finishRequest(false);
+					break;
+				}
+				continue;
+			}
+
+			auto status = _parser.getResponseStatus();
+			if (_state == EngineState::resync)
+			{
+				// the modem is alive, OK of the late reply or of AT, the other one is discarded
+				_state = EngineState::quiet;
+				_deadline = _serial->getus() + _quietWait * 1000ull;
+				continue;
+			}
+
+			if (_state == EngineState::setup)
+			{
+				if (status != ResponseStatus::ok)
+				{
+					_session._textMode.reset();
+					finishRequest(false);
+					break;
+				}
+
+				// mode applied, the request itself
+				_latency.record(commandName(_command), responseTime());
+				_session._textMode = _active._textMode;
+				if (!sendRequest())
+					break;
+				continue;
+			}
+
+			if (_state == EngineState::prompt)
+			{
+				if (status != ResponseStatus::smsready)
+				{
+					finishRequest(false);
+					break;
+				}
+
+				// payload, then the final status
+				_state = EngineState::response;
+				_parser.init(ParseCode::aBegin);
+				_parser.withPrefferedTag(_active._status);
+				_deadline = _serial->getus() + _timeout * 1000ull;
+				if (!sendData(_active._payload, _maxWaitTx, 0) || !sendData(gsm_cmd::CTRLZCR, _maxWaitTx))
+				{
+					finishRequest(false);
+					break;
+				}
+				continue;
+			}
+
+			if (status == _active._status)
+				_latency.record(commandName(_command), responseTime());
+			finishRequest(status == _active._status);
+			break;
+		}
+
+		return isBusy();
+	}
+
+	bool GSM::startRequest()
 	{
 		bool rc = false;
 		do
 		{
-			if (!sendCommand(command))
+			if (!_requests.pop(_active))
 				break;
 
-			_parser.withPrefferedTag(reqResStatus);
-			if (!processResponse(maxWait))
+			rc = true;
+
+			if (_callback)
+				_callback(GsmInfoState::rx);
+
+			if (!_active._textMode.has_value() || _session._textMode == _active._textMode)
+			{
+				sendRequest();
 				break;
+			}
 
-			if (_parser.getResponseStatus() == reqResStatus)
+			// SMS mode of the modem session differs, AT+CMGF first
+			_state = EngineState::setup;
+			_command = _active._textMode.value() ? gsm_cmd::C_ATCMGFON : gsm_cmd::C_ATCMGFOFF;
+			_parser.init(ParseCode::aBegin);
+			_parser.withPrefferedTag(ResponseStatus::ok);
+			if (!sendCommand(_command, _maxWaitTx))
 			{
-				rc = true;
+				finishRequest(false);
 				break;
 			}
 
+			arm(_command, _defaultWaitRx);
+
 		} while (false);
 		return rc;
 	}
 
-	std::size_t GSM::readLine(uint32_t maxWait)
+	bool GSM::sendRequest()
 	{
+		bool rc = false;
+		do
+		{
+			_state = _active._payload.empty() ? EngineState::response : EngineState::prompt;
+			_command = _active._command;
 
-		_line.clear();
-		auto tt = _serial->getus();
-		while (_serial->getus() - tt < maxWait * 1000)
+			_parser.init(ParseCode::aBegin);
+			_parser.withPrefferedTag((_state == EngineState::prompt) ? ResponseStatus::smsready : _active._status);
+
+			if (!sendCommand(_active._command, _maxWaitTx))
+			{
+				finishRequest(false);
+				break;
+			}
+
+			arm(_active._command, _active._maxWait);
+			rc = true;
+
+		} while (false);
+		return rc;
+	}
+
+	void GSM::arm(std::string_view command, uint32_t maxWait)
+	{
+		// learned response time, the requested wait or the command ceiling is only the upper limit
+		auto ceiling = maxWait;
+		for (const auto &c : gsm_cmd::C_CEILING)
 		{
-			if (_serial->isReadable())
+			if (command.size() >= c._command.size() && compareInsensitiveStr(command.substr(0, c._command.size()), c._command))
 			{
-				auto c = _serial->getc();
-				_line += c;
-				if (c == _ignorelineDelim)
-					break;
+				ceiling = c._ceiling;
+				break;
 			}
 		}
 
-		return _line.length();
+		_timeout = _latency.deadline(commandName(command), _minWaitRx, std::max(maxWait, ceiling));
+		_started = _serial->getus();
+		_deadline = _started + _timeout * 1000ull;
 	}
 
-	bool GSM::processResponse(uint32_t maxWait)
+	uint32_t GSM::responseTime() const
 	{
-		auto callbck = [this](GsmInfoState nfo)
+		return (uint32_t)((_serial->getus() - _started) / 1000);
+	}
+
+	std::string_view GSM::commandName(std::string_view command)
+	{
+		// AT+CMGR=3 -> AT+CMGR, AT+CMGD=1;+CMGD=2 -> AT+CMGD
+		auto name = command.substr(0, command.find_first_of("=\""));
+
+		// AT+CSQ;+CREG?;... -> one key for the telemetry lines, whatever the items
+		if (name.find(';') != std::string_view::npos)
+			return gsm_cmd::C_ATBATCH;
+		return name;
+	}
+
+	void GSM::expire()
+	{
+		switch (_state)
 		{
-			if (_callback)
-				_callback(nfo);
-		};
+		case EngineState::resync:
+			// no answer to AT either, the caller recovers the modem
+			_responsive = false;
+			finishRequest(false);
+			break;
+
+		case EngineState::quiet:
+			// the line is silent, the next request starts in sync
+			finishRequest(false);
+			break;
+
+		default:
+			// the next deadline of this command is longer
+			_latency.penalize(commandName(_command), _timeout);
+			if (_state == EngineState::response && compareInsensitiveStr(_command, gsm_cmd::C_AT))
+			{
+				// AT itself, its late OK is only discarded
+				_responsive = false;
+				_state = EngineState::quiet;
+				_deadline = _serial->getus() + _quietWait * 1000ull;
+				break;
+			}
+			resync();
+			break;
+		}
+	}
 
+	bool GSM::resync()
+	{
 		bool rc = false;
+		do
+		{
+			// the modem waits for the payload, ESC cancels the message
+			if (_state == EngineState::prompt && !sendData(gsm_cmd::CTRLESC, _maxWaitTx))
+			{
+				finishRequest(false);
+				break;
+			}
+
+			_state = EngineState::resync;
+			_command = gsm_cmd::C_AT;
+			_parser.init(ParseCode::aBegin);
+			_parser.withPrefferedTag(ResponseStatus::ok);
+			if (!sendCommand(gsm_cmd::C_AT, _maxWaitTx))
+			{
+				finishRequest(false);
+				break;
+			}
 
-		_parser.init(ParseCode::aBegin);
+			_deadline = _serial->getus() + _resyncWait * 1000ull;
+			rc = true;
 
-		auto tt = _serial->getus();
+		} while (false);
+		return rc;
+	}
 
-		callbck(GsmInfoState::rx);
+	void GSM::finishRequest(bool success)
+	{
+		auto callback = std::move(_active._callback);
+		_active = AtRequest{};
+		_state = EngineState::idle;
+		_command = {};
 
-		while (true)
+		// may submit the next request, not wait for it
+		if (callback)
+		{
+			_inCallback = true;
+			callback(success, _parser);
+			_inCallback = false;
+		}
+	}
+
+	std::size_t GSM::readLine(uint32_t maxWait, bool partial)
+	{
+		char chunk[_rxChunk];
+
+		if (_lineComplete)
 		{
+			_line.clear();
+			_lineComplete = false;
+		}
 
-			if (readLine(maxWait))
+		auto tt = _serial->getus();
+		while (true)
+		{
+			// whole line (or what has been received so far) per call
+			auto cnt = _serial->read(chunk, sizeof(chunk), _ignorelineDelim);
+			if (cnt)
 			{
-				if (_parser.parse(_line))
+				if (_nmeaLine || (_line.empty() && !_smsText && chunk[0] == '$' && _session._gnssStream.value_or(false)))
 				{
-					rc = true;
+					// NMEA stream is neither a response nor an event, parsed here as it arrives
+					_nmeaLine = chunk[cnt - 1] != _ignorelineDelim;
+					if (_nmea.push(std::string_view(chunk, cnt)))
+					{
+						_gnssFix = _nmea.fix();
+						_gnssFix->_stamp = _serial->getus();
+					}
+					continue;
+				}
+
+				if (_line.empty())
+					_traceKeep = traceKeep(std::string_view(chunk, cnt));
+				_trace.record(TraceDir::rx, _serial->getus(), std::string_view(chunk, cnt), _traceKeep);
+				if (_traceKeep != std::string_view::npos)
+					_traceKeep -= std::min(_traceKeep, cnt);
+				_line.append(chunk, cnt);
+				if (chunk[cnt - 1] == _ignorelineDelim)
+				{
+					if (captureSms(_line))
+					{
+						// +CMT is not a part of any response, the message is ready for checkStatus
+						_line.clear();
+						if (_smsText)
+							continue;
+						break;
+					}
+					_lineComplete = true;
+					observe(decoder::trim(_line));
 					break;
 				}
+				continue;
 			}
 
-			if (_serial->getus() - tt > maxWait * 1000)
+			// +CMT text without the length ends by a pause
+			if (_smsText && _serial->getus() - _smsStamp >= _smsIdle * 1000ull)
+				completeSms();
+
+			auto elapsed = _serial->getus() - tt;
+			if (elapsed >= maxWait * 1000ull)
 				break;
+
+			// sleep until the next line (or idle line) instead of spinning
+			_serial->waitReadable((uint32_t)((maxWait * 1000ull - elapsed) / 1000) + 1);
 		}
 
-		return rc;
+		// unterminated line is kept for the next call, unless partial content is accepted
+		if (partial && !_line.empty())
+			_lineComplete = true;
+
+		return _lineComplete ? _line.length() : 0;
 	}
 
-	bool GSM::sendCommand(std::string_view command, uint32_t maxWait)
+	bool GSM::isUrc(std::string_view line) const
 	{
-		bool rc = false;
-		std::size_t pos{0};
-		uint64_t t = 0;
-		t = _serial->getus();
-		std::string acc;
-
-		if (_callback)
-			_callback(GsmInfoState::tx);
+		auto key = [](std::string_view str)
+		{
+			// "+CMTI: "SM",1" -> "CMTI", "RING" -> "RING"
+			str = decoder::trim(str);
+			if (!str.empty() && str.front() == '+')
+				str.remove_prefix(1);
+			return str.substr(0, str.find(':'));
+		};
 
-		while (true)
+		bool rc = false;
+		do
 		{
-			if (!_serial)
+			auto lineKey = key(line);
+			if (lineKey.empty())
 				break;
 
-			if ((_serial->getus() - t) > maxWait * 1000)
+			// the reply of the running command, e.g. +CREG: 0,1 for AT+CREG? or AT+CSQ;+CREG?
+			bool reply = false;
+			auto cmd = _command;
+			if (cmd.size() > 2 && compareInsensitiveStr(cmd.substr(0, 2), gsm_cmd::C_AT))
+			{
+				cmd.remove_prefix(2);
+				while (!cmd.empty() && !reply)
+				{
+					auto part = cmd.substr(0, cmd.find(';'));
+					cmd.remove_prefix(std::min(part.size() + 1, cmd.size()));
+					if (part.empty() || !isAtBegin(part.front()))
+						continue;
+					part.remove_prefix(1);
+					reply = compareInsensitiveStr(lineKey, part.substr(0, part.find_first_of("=?")));
+				}
+			}
+			if (reply)
 				break;
 
-			if (!_serial->isWritable())
+			for (auto urc : gsm_cmd::C_URC)
+			{
+				if (compareInsensitiveStr(lineKey, urc))
+				{
+					rc = true;
+					break;
+				}
+			}
+		} while (false);
+		return rc;
+	}
+
+	void GSM::observe(std::string_view line)
+	{
+		for (const auto &b : gsm_cmd::C_BOOT)
+		{
+			if (!compareInsensitiveStr(line, b._token))
 				continue;
 
-			if (pos != command.length())
+			if (b._flag == ModemBoot::rdy)
 			{
-				acc += command.at(pos);
-				_serial->putch(command.at(pos++));
+				// modem (re)start, settings are lost
+				_session = {};
+				_boot = 0;
 			}
-			else
+			if (b._flag == ModemBoot::cpin)
+				_boot &= ~ModemBoot::simError;
+			_boot |= b._flag;
+			return;
+		}
+
+		// +CPIN: SIM PIN, +CPIN: NOT INSERTED ...
+		if (compareInsensitiveStr(line.substr(0, gsm_cmd::C_CPINA.size()), gsm_cmd::C_CPINA))
+			_boot |= ModemBoot::simError;
+	}
+
+	bool GSM::captureSms(std::string_view line)
+	{
+		bool rc = true;
+		do
+		{
+			auto text = line.substr(0, line.find_last_not_of("\r\n") + 1);
+			auto header = decoder::trim(line);
+			bool cmt = compareInsensitiveStr(header.substr(0, gsm_cmd::C_CMT.size()), gsm_cmd::C_CMT);
+
+			if (_smsText && _smsPdu && !cmt)
 			{
-				_serial->putch('\r');
-				_serial->putch('\n');
-				rc = true;
+				// one hex line in the PDU mode
+				if (!text.empty())
+					deliverPdu(header);
+				break;
+			}
+
+			if (_smsText)
+			{
+				// the length of the AT+CSDH=1 header ends the text, otherwise a blank line,
+				// the next header or a result code after the first line
+				bool first = _smsReceived == 0;
+				bool end = cmt || (!_smsExpected && !first &&
+								   (text.empty() || isUrc(line) || compareInsensitiveStr(header, ATStatusTrie.token(ResponseStatus::ok)) ||
+									compareInsensitiveStr(header, ATStatusTrie.token(ResponseStatus::error))));
+				if (!end)
+				{
+					appendSms(line);
+					break;
+				}
+
+				completeSms();
+				if (text.empty())
+					break;
+			}
+
+			// the line is not a part of the message, processed as usual
+			if (!cmt)
+			{
+				rc = false;
 				break;
 			}
+
+			_sms._header = (uint8_t)std::min(header.size(), _maxSmsHeader);
+			memcpy(_sms._data, header.data(), _sms._header);
+			_sms._length = _sms._header;
+
+			// +CMT: "+420123456789","","23/03/04,08:22:23+04",145,4,0,0,"+420603052000",145,5
+			auto full = decode<decoder::Quoted, decoder::Text, decoder::Quoted, decoder::Int, decoder::Int, decoder::Int,
+							   decoder::Int, decoder::Quoted, decoder::Int, decoder::Int>(decoder::valueOf(header));
+			_smsExpected = full.has_value() ? (uint16_t)std::max<int32_t>(0, std::get<9>(full.value())) : 0;
+
+			// +CMT: ,24 - the PDU length in octets, AT+CMGF=0
+			_smsPdu = !full.has_value() && decode<decoder::Text, decoder::Int>(decoder::valueOf(header)).has_value();
+			_smsReceived = 0;
+			_smsStamp = _serial->getus();
+			_smsText = true;
+		} while (false);
+		return rc;
+	}
+
+	void GSM::appendSms(std::string_view line)
+	{
+		// lines of the text are joined by '\n'
+		if (_smsReceived && _sms._length < sizeof(_sms._data))
+			_sms._data[_sms._length++] = '\n';
+
+		auto text = line.substr(0, line.find_last_not_of("\r\n") + 1);
+		auto cnt = std::min(text.size(), sizeof(_sms._data) - _sms._length);
+		memcpy(_sms._data + _sms._length, text.data(), cnt);
+		_sms._length = (uint16_t)(_sms._length + cnt);
+		_smsStamp = _serial->getus();
+
+		// the line ends are a part of the length, "\r\n" in the text is one line break here
+		_smsReceived += line.size();
+		if (_smsExpected && _smsReceived >= _smsExpected)
+			completeSms();
+	}
+
+	void GSM::completeSms()
+	{
+		_smsText = false;
+		_smsPdu = false;
+		_smsExpected = 0;
+		_directSms.push(_sms);	// full queue counts as dropped event
+	}
+
+	void GSM::deliverPdu(std::string_view hex)
+	{
+		auto sms = decodeDeliver(hex);
+		if (sms.has_value())
+		{
+			// the text mode form for checkStatus, the PDU header is kept if not decoded
+			auto header = std::string(gsm_cmd::C_CMT) + " \"" + sms->_number + "\",\"\",\"" + sms->_stamp + "\"";
+			_sms._header = (uint8_t)std::min(header.size(), _maxSmsHeader);
+			memcpy(_sms._data, header.data(), _sms._header);
+			auto cnt = std::min(sms->_text.size(), sizeof(_sms._data) - _sms._header);
+			memcpy(_sms._data + _sms._header, sms->_text.data(), cnt);
+			_sms._length = (uint16_t)(_sms._header + cnt);
 		}
+		completeSms();
+	}
+
+	void GSM::storeSms()
+	{
+		// e.g. a garbled +CMT header, the next messages are stored and read by AT+CMGL
+		_smsErrors++;
 
+		AtRequest store;
+		store._command = gsm_cmd::C_CNMISTORE;
+		store._callback = [this](bool success, ATParser &)
+		{
+			_session._directSms = success ? std::optional<bool>(false) : std::nullopt;
+		};
+		submit(store);
+	}
+
+	std::size_t GSM::traceKeep(std::string_view line) const
+	{
+		// "+CMT: ..." - the number, the time stamp, the key is kept
+		for (auto key : gsm_cmd::C_PRIVATE)
+		{
+			if (compareInsensitiveStr(line.substr(0, key.size()), key))
+				return key.size();
+		}
+
+		// the message text of +CMT and of the listing, the result code is kept
+		if (_smsText)
+			return 0;
+
+		if (_state == EngineState::response &&
+			(_command.find(gsm_cmd::C_CMGL) != std::string_view::npos || _command.find(gsm_cmd::C_CMGR) != std::string_view::npos))
+		{
+			auto status = decoder::trim(line);
+			if (!status.empty() && !compareInsensitiveStr(status, ATStatusTrie.token(ResponseStatus::ok)) &&
+				!compareInsensitiveStr(status, ATStatusTrie.token(ResponseStatus::error)) &&
+				!compareInsensitiveStr(status.substr(0, gsm_cmd::C_CMSERROR.size()), gsm_cmd::C_CMSERROR))
+				return 0;
+		}
+		return std::string_view::npos;
+	}
+
+	void GSM::pushUrc(std::string_view line)
+	{
+		UrcLine urc;
+		line = decoder::trim(line);
+		urc._length = (uint8_t)std::min(line.size(), sizeof(urc._data));
+		memcpy(urc._data, line.data(), urc._length);
+		_urc.push(urc);	// full queue counts as dropped event
+	}
+
+	bool GSM::sendCommand(std::string_view command, uint32_t maxWait)
+	{
+		bool rc = false;
+		do
+		{
+			// AT+CMGS="+420123456789" - the number is not traced
+			auto keep = compareInsensitiveStr(command.substr(0, gsm_cmd::C_ATCMGS.size()), gsm_cmd::C_ATCMGS) ? gsm_cmd::C_ATCMGS.size() + 1 : std::string_view::npos;
+			if (!sendData(command, maxWait, keep))
+				break;
+
+			if (!sendData("\r\n"sv, maxWait))
+				break;
+
+			rc = true;
+
+		} while (false);
 		return rc;
 	}
 
-	bool GSM::sendData(std::string_view data, uint32_t maxWait)
+	bool GSM::sendData(std::string_view data, uint32_t maxWait, std::size_t keep)
 	{
 		bool rc = false;
-		std::size_t pos{0};
-		uint64_t t = 0;
-		t = _serial->getus();
-		std::string acc;
+		auto t = _serial->getus();
 
 		if (_callback)
 			_callback(GsmInfoState::tx);
@@ -605,22 +1703,21 @@ namespace gsm
 			if (!_serial)
 				break;
 
-			if ((_serial->getus() - t) > maxWait * 1000)
-				break;
-
-			if (!_serial->isWritable())
-				continue;
-
-			if (pos != data.length())
-			{
-				acc += data.at(pos);
-				_serial->putch(data.at(pos++));
-			}
-			else
+			if (data.empty())
 			{
 				rc = true;
 				break;
 			}
+
+			if ((_serial->getus() - t) > maxWait * 1000)
+				break;
+
+			// as much as the transmitter accepts at once
+			auto cnt = _serial->write(data);
+			_trace.record(TraceDir::tx, _serial->getus(), data.substr(0, cnt), keep);
+			if (keep != std::string_view::npos)
+				keep -= std::min(keep, cnt);
+			data.remove_prefix(cnt);
 		}
 
 		return rc;
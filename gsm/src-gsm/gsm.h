@@ -9,11 +9,16 @@
 
 #include <inttypes.h>
 #include <string>
+#include <vector>
 #include <string_view>
 #include <functional>
 #include "pico/util/datetime.h"
 #include "at_parser.h"
 #include "serial_modem_intf.h"
+#include "latency_tracker.h"
+#include "at_trace.h"
+#include "nmea_parser.h"
+#include "../src-utils/ring_buffer.h"
 
 namespace gsm {
 
@@ -35,6 +40,111 @@ enum class GsmInfoState
 
 typedef std::function<void (GsmInfoState state)> GSMInfoCallback;
 
+/**
+ * @brief completion of the asynchronous AT request, called from GSM::poll.
+ * Only asynchronous requests can be submitted here, the synchronous calls fail.
+ * 
+ */
+typedef std::function<void (bool success, ATParser &parser)> ATCallback;
+
+/**
+ * @brief one line of the response with its line end, called from GSM::poll before the parser.
+ * Returns true for a data line (e.g. SMS text), the parser does not see it, an "OK" text
+ * cannot complete the request.
+ * 
+ */
+typedef std::function<bool (std::string_view line)> LineCallback;
+
+/**
+ * @brief evaluated result of the asynchronous operation, std::nullopt if failed
+ * 
+ */
+template <typename T>
+using ResultCallback = std::function<void (std::optional<T> result)>;
+
+/**
+ * @brief modem start-up progress, collected from the boot messages
+ * 
+ */
+struct ModemBoot
+{
+    static constexpr uint8_t rdy{0x01};         ///< RDY - modem (re)started
+    static constexpr uint8_t cfun{0x02};        ///< +CFUN: 1 - radio on
+    static constexpr uint8_t cpin{0x04};        ///< +CPIN: READY - SIM ready
+    static constexpr uint8_t callReady{0x08};   ///< Call Ready
+    static constexpr uint8_t smsReady{0x10};    ///< SMS Ready
+    static constexpr uint8_t simError{0x20};    ///< +CPIN: other than READY
+};
+
+/**
+ * @brief recovery steps, ordered from the cheapest one
+ * 
+ */
+enum class RecoveryTier
+{
+    none,           ///< not needed
+    resync,         ///< AT answers, registered
+    radio,          ///< AT+CFUN=0 / AT+CFUN=1
+    registration,   ///< AT+COPS=0, network search
+    powerCycle,     ///< power toggle + init, SIM setup required
+    failed          ///< modem does not start
+};
+
+/**
+ * @brief result of GSM::recover
+ * 
+ */
+struct RecoveryReport
+{
+    RecoveryTier _tier{RecoveryTier::none};     ///< the step that recovered the modem
+    uint32_t _elapsedMs{0};                     ///< time spent
+};
+
+/**
+ * @brief modem state collected by one batched query, see GSM::telemetry
+ * 
+ */
+struct Telemetry
+{
+    static constexpr uint8_t signal{0x01};          ///< AT+CSQ
+    static constexpr uint8_t registration{0x02};    ///< AT+CREG?
+    static constexpr uint8_t provider{0x04};        ///< AT+COPS?
+    static constexpr uint8_t rtc{0x08};             ///< AT+CCLK?
+    static constexpr uint8_t gnss{0x10};            ///< AT+CGNSINF
+    static constexpr uint8_t storage{0x20};         ///< AT+CPMS?
+    static constexpr uint8_t all{0x3f};
+
+    std::optional<uint8_t> _signal;                 ///< rssi, see GSM::qualitySignal
+    std::optional<uint8_t> _registration;           ///< stat, see GSM::isRegistered
+    std::optional<std::string> _operator;           ///< operator name
+    std::optional<datetime_t> _rtc;                 ///< modem RTC, UTC
+    std::optional<std::tuple<datetime_t, bool, bool>> _gnss; ///< GNSS time, fix, run status
+    std::optional<std::tuple<uint32_t, uint32_t>> _storage;  ///< stored SMS, capacity
+    uint64_t _sent{0};                              ///< [us] local time the command was sent
+    uint64_t _rtcStamp{0};                          ///< [us] local time of the +CCLK line, the RTC was read after _sent
+};
+
+/**
+ * @brief queued AT request
+ * 
+ */
+struct AtRequest
+{
+    std::string _command;                           ///< AT command without CRLF
+    ResponseStatus _status{ResponseStatus::ok};     ///< expected final status
+    uint32_t _maxWait{20000};                       ///< deadline [ms] from the command start
+    std::string _payload;                           ///< data sent after the "> " prompt (AT+CMGS), terminated by Ctrl+Z
+    std::optional<bool> _textMode{};                ///< required SMS mode, AT+CMGF is sent first if the modem differs
+    ATCallback _callback{};                         ///< completion
+    LineCallback _onLine{};                         ///< every response line, for responses longer than the parser capacity
+};
+
+/**
+ * @brief received SMS - message, caller id, timestamp
+ * 
+ */
+using SmsMessage = std::tuple<std::string, std::string, datetime_t>;
+
 
 
 /**
@@ -45,6 +155,8 @@ class GSM
 {
 
 public:
+    using Trace = AtTrace<64>;                      ///< 4 kB, the last ~3 kB of the AT traffic
+
     explicit GSM(ISerialModem &s) : _serial(&s)
     {
     }
@@ -52,10 +164,11 @@ public:
     /**
      * @brief tries to initialize the modem, 
      * or switch it on if it has been switched off and establish reliable communication. 
+     * The power key is tried a few times, then the modem is given up.
      * 
      * @param withGnss  - GPS init required
      * @return true 
-     * @return false 
+     * @return false - the modem does not answer after the power cycles
      */
     bool init(bool withGnss = false);
 
@@ -133,6 +246,32 @@ public:
      */
     std::optional<uint8_t> isRegistered();
 
+    /**
+     * @brief repeats isRegistered() until the registration is finished (home, roaming, denied)
+     * 
+     * @param maxWait - [ms]
+     * @return std::optional<uint8_t> - the last registration state
+     */
+    std::optional<uint8_t> waitRegistered(uint32_t maxWait);
+
+    /**
+     * @brief ICCID, PIN state and caller ID setup in one command line
+     * 
+     * @param callerId - caller ID on/off
+     * @return std::optional<std::tuple<std::string, bool>> - ICCID, PIN not required;
+     * std::nullopt if any of the commands failed
+     */
+    std::optional<std::tuple<std::string, bool>> simSetup(bool callerId = true);
+
+    /**
+     * @brief start-up messages seen since the last modem start
+     * 
+     * @return uint8_t - ModemBoot flags
+     */
+    uint8_t bootState() const {
+        return _boot;
+    }
+
     /**
      * @briefinforms about the quality of the received signal. 
      * If communication with the modem has failed, no value is returned
@@ -151,6 +290,15 @@ public:
      */
     std::optional<uint8_t> qualitySignal();
 
+    /**
+     * @brief asynchronous qualitySignal()
+     * 
+     * @param clb - result
+     * @return true - queued
+     * @return false 
+     */
+    bool qualitySignal(ResultCallback<uint8_t> clb);
+
     /**
      * @brief It asks if you need a PIN to use the SIM card. 
      *  If communication with the modem has failed, no value is returned
@@ -178,6 +326,15 @@ public:
      */
     std::optional<std::string> getOperator();
 
+    /**
+     * @brief asynchronous getOperator()
+     * 
+     * @param clb - result
+     * @return true - queued
+     * @return false 
+     */
+    bool getOperator(ResultCallback<std::string> clb);
+
 
     /**
      * @brief send smsm to phone number
@@ -222,6 +379,91 @@ public:
      */
     ResponseStatus checkStatus(uint32_t maxWait=_defaultCheckModem);
 
+    /**
+     * @brief brings the modem back after communication or network failure.
+     * The steps are tried from the cheapest one: AT resync, radio off/on, network
+     * registration and power cycle as the last resort. The SMS storage is kept.
+     * 
+     * @param withGnss - GPS init required after the power cycle
+     * @return RecoveryReport - step reached and time spent
+     */
+    RecoveryReport recover(bool withGnss = false);
+
+    /**
+     * @brief the last recover() result
+     * 
+     * @return RecoveryReport 
+     */
+    RecoveryReport lastRecovery() const {
+        return _lastRecovery;
+    }
+
+    /**
+     * @brief number of recover() calls
+     * 
+     * @return uint32_t 
+     */
+    uint32_t recoveries() const {
+        return _recoveries;
+    }
+
+    /**
+     * @brief completes the request in progress and all the queued ones as failed
+     * 
+     */
+    void cancelRequests();
+
+    /**
+     * @brief queue the AT request, the request is processed by poll()
+     * 
+     * @param request 
+     * @return true - queued
+     * @return false - queue is full
+     */
+    bool submit(const AtRequest &request);
+
+    /**
+     * @brief drives the queued requests - sends the next command, collects the response,
+     * completes the request by its callback. Returns after the first completion.
+     * 
+     * @param maxWait - maximum blocking time, 0 - only what has been received
+     * @return true - requests are still in progress
+     * @return false - idle
+     */
+    bool poll(uint32_t maxWait = 0);
+
+    /**
+     * @brief request in progress or queued
+     * 
+     * @return true 
+     * @return false 
+     */
+    bool isBusy() const {
+        return _state != EngineState::idle || !_requests.empty();
+    }
+
+    /**
+     * @brief the modem answers, a timed out request is a modem failure only if the AT resync
+     * after it is not answered either
+     * 
+     * @return true - something received since the last unanswered AT
+     */
+    bool isResponsive() const {
+        return _responsive;
+    }
+
+    /**
+     * @brief timeout of the request in progress, poll() has to be called then even if nothing is received;
+     * without a request the end of the +CMT text without the length, checkStatus() completes it
+     * 
+     * @return uint64_t - [us], 0 - nothing expected
+     */
+    uint64_t deadline() const {
+        if (_state != EngineState::idle)
+            return _deadline;
+        return _smsText ? _smsStamp + _smsIdle * 1000ull : 0;
+    }
+
     /**
      * @brief Powr ON / OFF GNSS part if exists
      * 
@@ -241,6 +483,25 @@ public:
      */
     std::optional<std::tuple<datetime_t, bool, bool>> gnssInfo();
 
+    /**
+     * @brief queries several values in one command line, e.g. AT+CSQ;+CREG?;+COPS?;+CCLK?
+     * 
+     * @param items - Telemetry::signal | Telemetry::provider ...
+     * @return std::optional<Telemetry> - requested values, each one optional, the ones after
+     * a failed command are missing; std::nullopt if nothing is answered
+     */
+    std::optional<Telemetry> telemetry(uint8_t items = Telemetry::all);
+
+    /**
+     * @brief asynchronous telemetry()
+     * 
+     * @param items - Telemetry::signal | Telemetry::provider ...
+     * @param clb - result
+     * @return true - queued
+     * @return false 
+     */
+    bool telemetry(uint8_t items, ResultCallback<Telemetry> clb);
+
     /**
      * @brief Delete defined SMS message defined by index
      * 
@@ -277,6 +538,34 @@ public:
      * 3.rd. = massage time stamp
      */
     std::optional<std::tuple<std::string, std::string,  datetime_t>> readSMS(uint32_t index);
+
+    /**
+     * @brief asynchronous readSMS()
+     * 
+     * @param index - messex index
+     * @param clb - result
+     * @return true - queued
+     * @return false 
+     */
+    bool readSMS(uint32_t index, ResultCallback<std::tuple<std::string, std::string, datetime_t>> clb);
+
+    /**
+     * @brief reads all received messages in one AT+CMGL="ALL" and deletes the listed ones by AT+CMGD,
+     * a few of them per command line. The messages with a broken header are deleted without
+     * the hand over, the failed deletes are retried by the next drain.
+     * 
+     * @return std::optional<std::vector<SmsMessage>> - messages in the storage order
+     */
+    std::optional<std::vector<SmsMessage>> drainInbox();
+
+    /**
+     * @brief asynchronous drainInbox()
+     * 
+     * @param clb - messages, called from poll()
+     * @return true - queued
+     * @return false - queue is full
+     */
+    bool drainInbox(ResultCallback<std::vector<SmsMessage>> clb);
     
     /**
      * @brief Get the Callers ID, can be called after ResponseStatus::callerid status 
@@ -314,29 +603,266 @@ public:
      */
     bool setCallerID(bool enable);
 
+    /**
+     * @brief shows the text mode header values in +CMGR, +CMGL, +CMT (AT+CSDH)
+     * 
+     * @param enable 
+     * @return true - success
+     * @return false 
+     */
+    bool showSMSHeader(bool enable);
+
+    /**
+     * @brief SMS text / PDU mode, sent only if the modem session differs
+     * 
+     * @param enable - true text mode (AT+CMGF=1), false PDU mode
+     * @return true - success
+     * @return false 
+     */
+    bool ensureTextMode(bool enable = true);
+
+    /**
+     * @brief new SMS delivery, AT+CNMI
+     * 
+     * @param enable - true the message is delivered in the +CMT unsolicited result code and not stored,
+     *                 false the message is stored and announced by +CMTI.
+     *                 +CMT is decoded in the text and the PDU mode (a concatenated SMS part of SmsOutbox).
+     * @return true - success
+     * @return false 
+     */
+    bool directSMS(bool enable);
+
+    /**
+     * @brief NMEA output of the GNSS part on the AT port, AT+CGNSTST
+     * 
+     * @param enable - true RMC / GGA sentences are parsed as they arrive, see gnssFix,
+     *                 other lines starting with '$' are ignored while enabled
+     * @return true - success
+     * @return false 
+     */
+    bool gnssStream(bool enable);
+
+    /**
+     * @brief the last fix from the NMEA stream, updated by every RMC sentence (1 Hz)
+     * 
+     * @return std::optional<GnssFix> - std::nullopt until the first RMC with the date
+     */
+    std::optional<GnssFix> gnssFix() const {
+        return _gnssFix;
+    }
+
+    /**
+     * @brief NMEA stream statistics
+     * 
+     * @return const NmeaParser& 
+     */
+    const NmeaParser &nmea() const {
+        return _nmea;
+    }
+
+    /**
+     * @brief the last message delivered by +CMT, can be called after ResponseStatus::directsms status
+     * 
+     * @return std::optional<std::tuple<std::string, std::string, datetime_t>> - message, caller id, timestamp
+     */
+    std::optional<std::tuple<std::string, std::string, datetime_t>> incomingSMS() const {
+        return _lastSms;
+    }
+
+    /**
+     * @brief +CMT messages that could not be decoded, e.g. a garbled header or PDU; the delivery
+     * is switched to the storage (+CMTI) after the first one
+     * 
+     * @return uint32_t 
+     */
+    uint32_t smsErrors() const {
+        return _smsErrors;
+    }
+
+    /**
+     * @brief number of unsolicited result codes (RING, +CMTI ...) waiting for checkStatus
+     * 
+     * @return std::size_t 
+     */
+    std::size_t pendingEvents() const {
+        return _urc.size() + _directSms.size();
+    }
+
+    /**
+     * @brief handed over messages still in the storage, their AT+CMGD failed
+     * 
+     * @return std::size_t 
+     */
+    std::size_t undeletedSMS() const {
+        return _undeleted.size();
+    }
+
+    /**
+     * @brief unsolicited result codes lost because the event queue was full
+     * 
+     * @return uint32_t 
+     */
+    uint32_t droppedEvents() const {
+        return _urc.overruns() + _directSms.overruns();
+    }
+
+    /**
+     * @brief recorded TX / RX traffic, see host/at_replay.cpp; the numbers and the SMS texts
+     * are masked unless Trace::capturePrivate is enabled
+     * 
+     * @return Trace& 
+     */
+    Trace &trace() {
+        return _trace;
+    }
+
     void whitInfoCallback(GSMInfoCallback clb);
 
 private:
     static const uint32_t _maxWaitTx{100};
     static const uint32_t  _defaultWaitRx{20000};
     static const uint32_t  _maxtWaitRx{200000};
+    static constexpr uint32_t _minWaitRx{300};
     static const uint32_t _defaultCheckModem{500};
+    static constexpr uint32_t _bootWait{10000};
+    static constexpr uint32_t _powerAttempts{3};
+    static constexpr uint32_t _powerDownWait{2000};
+    static constexpr uint32_t _readyWait{30000};
+    static constexpr uint32_t _bootPoll{250};
+    static constexpr uint32_t _registrationPoll{1000};
+    static constexpr uint32_t _recoveryRegistration{30000};
+    static constexpr uint32_t _resyncWait{5000};
+    static constexpr uint32_t _quietWait{100};
+    static constexpr std::size_t _latencySlots{16};
+    static constexpr std::size_t _rxChunk{64};
+    static constexpr std::size_t _maxUrcLength{64};
+    static constexpr std::size_t _maxUrcEvents{8};
+    static constexpr std::size_t _maxRequests{8};
+    static constexpr std::size_t _maxSmsHeader{96};
+    static constexpr std::size_t _maxSmsLength{_maxSmsHeader + 160};
+    static constexpr std::size_t _maxDirectSms{4};
+    static constexpr uint32_t _smsIdle{200};
+    static constexpr std::size_t _maxDeletes{16};
+
+    /**
+     * @brief modem settings applied in the current modem session,
+     * std::nullopt - unknown, the command is always sent.
+     * Cleared on power cycle and on the RDY of the modem restart.
+     * 
+     */
+    struct SessionState
+    {
+        std::optional<bool> _echo;          ///< ATE
+        std::optional<bool> _textMode;      ///< AT+CMGF
+        std::optional<bool> _callerId;      ///< AT+CLIP
+        std::optional<bool> _smsHeader;     ///< AT+CSDH
+        std::optional<bool> _directSms;     ///< AT+CNMI
+        std::optional<bool> _gnssStream;    ///< AT+CGNSTST
+    };
+
+    /**
+     * @brief request processing
+     * 
+     */
+    enum class EngineState
+    {
+        idle,       ///< no request
+        setup,      ///< waiting for the AT+CMGF required by the request
+        prompt,     ///< waiting for "> " before the payload
+        response,   ///< waiting for the final status
+        resync,     ///< the request timed out, AT sent, waiting for its OK
+        quiet       ///< AT answered, the late reply is discarded until the line is silent
+    };
+
+    /**
+     * @brief unsolicited result code line, kept until checkStatus
+     * 
+     */
+    struct UrcLine
+    {
+        uint8_t _length{0};
+        char _data[_maxUrcLength];
+    };
+
+    /**
+     * @brief +CMT header and the message text, kept until checkStatus
+     * 
+     */
+    struct SmsLine
+    {
+        uint8_t _header{0};         ///< length of the header, the text follows
+        uint16_t _length{0};
+        char _data[_maxSmsLength];
+    };
 
     bool sendCMD_waitResp(const char *str, const char *back, int timeout);
-    void eatSerial(uint32_t maxWait = _defaultWaitRx);
+    void eatSerial(uint32_t maxWait = _defaultWaitRx, uint8_t flags = 0);
+    bool waitAlive(uint32_t maxWait);
+    bool powerCycle(bool responsive, bool withGnss);
+    bool waitReady(uint32_t maxWait);
+    void observe(std::string_view line);
     bool sendAndRead(std::string_view command, ResponseStatus reqResStatus, uint32_t maxWait = _defaultWaitRx);
     bool sendCommand(std::string_view command, uint32_t maxWait = _defaultWaitRx);
-    bool sendData(std::string_view data, uint32_t maxWait);
-    bool processResponse(uint32_t maxWait = _defaultWaitRx);
-    std::size_t readLine(uint32_t maxWait);
+    bool sendData(std::string_view data, uint32_t maxWait, std::size_t keep = std::string_view::npos);
+    std::size_t traceKeep(std::string_view line) const;
+    bool execute(const AtRequest &request);
+    void wait(const bool &done);
+    bool startRequest();
+    bool sendRequest();
+    bool apply(std::optional<bool> &state, bool value, std::string_view command);
+    void arm(std::string_view command, uint32_t maxWait);
+    uint32_t responseTime() const;
+    static std::string_view commandName(std::string_view command);
+    void expire();
+    bool resync();
+    void finishRequest(bool success);
+    std::size_t readLine(uint32_t maxWait, bool partial = true);
+    bool isUrc(std::string_view line) const;
+    bool captureSms(std::string_view line);
+    void appendSms(std::string_view text);
+    void completeSms();
+    void deliverPdu(std::string_view hex);
+    void storeSms();
+    void pushUrc(std::string_view line);
+    void deleteSMS(const std::vector<uint32_t> &indexes);
 
     ATParser _parser;
     ISerialModem *_serial{nullptr};
-    bool _echo{true};
+    SessionState _session;                          ///< settings applied since the modem start
+    uint8_t _boot{0};                               ///< ModemBoot flags
+    RecoveryReport _lastRecovery;                   ///< the last recovery
+    uint32_t _recoveries{0};                        ///< number of recoveries
     std::string _lastNumber;
     std::string _lastStorage;
     uint32_t     _lastMessageNumber{0};
     std::string _line;
+    std::string_view _command;                      ///< command waiting for its response
+    RingBuffer<UrcLine, _maxUrcEvents> _urc;        ///< unsolicited result codes received during commands
+    RingBuffer<SmsLine, _maxDirectSms> _directSms;  ///< messages delivered by +CMT
+    SmsLine _sms;                                   ///< +CMT header waiting for the message text
+    bool _smsText{false};                           ///< the next line is the message text
+    uint16_t _smsExpected{0};                       ///< text length of the AT+CSDH=1 header, 0 - unknown
+    uint16_t _smsReceived{0};                       ///< characters of the text received, including the line ends
+    uint64_t _smsStamp{0};                          ///< [us] the last line of the message, the text without the length ends by a pause
+    uint32_t _smsErrors{0};                         ///< +CMT not decoded
+    bool _smsPdu{false};                            ///< the next line is the PDU of +CMT, AT+CMGF=0
+    std::vector<uint32_t> _undeleted;               ///< storage indexes of the handed over messages, AT+CMGD failed
+    NmeaParser _nmea;                               ///< AT+CGNSTST stream
+    std::optional<GnssFix> _gnssFix;                ///< the last RMC
+    bool _nmeaLine{false};                          ///< the rest of the NMEA sentence follows
+    std::size_t _traceKeep{std::string_view::npos}; ///< traced characters of the received line, the rest is private
+    std::optional<std::tuple<std::string, std::string, datetime_t>> _lastSms;
+    RingBuffer<AtRequest, _maxRequests> _requests;  ///< queued requests
+    Trace _trace;                                   ///< AT traffic capture
+    AtRequest _active;                              ///< request in progress
+    EngineState _state{EngineState::idle};          ///< request processing
+    uint64_t _deadline{0};                          ///< [us] of the request in progress
+    uint64_t _started{0};                           ///< [us] command of the request sent
+    uint32_t _timeout{0};                           ///< [ms] deadline of the command in progress
+    LatencyTracker<_latencySlots> _latency;         ///< observed response times
+    bool _lineComplete{true};                       ///< _line consumed, the next read starts a new one
+    bool _inCallback{false};                        ///< request callback running, the synchronous calls fail
+    bool _responsive{true};                         ///< the modem answered since the last unanswered AT
     GSMInfoCallback _callback{};
 };
 
@@ -15,40 +15,96 @@ namespace gsm {
 
 namespace gsm_cmd
 {
-std::string_view C_AT{"AT"};
-std::string_view C_ATE0{"ATE0"};
-std::string_view C_ATE1{"ATE1"};
-std::string_view C_ATCFUN0{"AT+CFUN=0"};
-std::string_view C_ATCFUN1{"AT+CFUN=1"};
-std::string_view C_ATCCLK{"AT+CCLK?"};
-std::string_view C_ATCCLKON{"AT+CLTS=1"};
-std::string_view C_ATCCLKOFF{"AT+CLTS=0"};
-std::string_view C_ATW{"AT&W"};
-std::string_view C_ATCREG{"AT+CREG?"};
-std::string_view C_ATCSQ{"AT+CSQ"};
-std::string_view C_ATCPIN{"AT+CPIN?"};
-std::string_view C_ATCMGFON{"AT+CMGF=1"};
-std::string_view C_ATCMGS{"AT+CMGS"};
-std::string_view C_ATCCID{"AT+CCID"};
-std::string_view C_ATCOPS{"AT+COPS?"};
-std::string_view C_ATA{"ATA"};
-std::string_view C_ATH{"ATH"};
-std::string_view C_ATD{"ATD+"};
-std::string_view C_CLIPON{"AT+CLIP=1"};
-std::string_view C_CLIPOFF{"AT+CLIP=0"};
-std::string_view C_CMGD000{"AT+CMGD="};
-std::string_view C_CMGR000{"AT+CMGR="};
-std::string_view C_CSDHON{"AT+CSDH=1"};
-std::string_view C_CATPMS{"AT+CPMS?"};
-std::string_view C_CPMS{"CPMS"};
-std::string_view C_CMGDAALL{"AT+CMGDA=\"DEL ALL\""};
-std::string_view C_CMGR{"CMGR"};
-std::string_view C_CGNSINFA{"CGNSINF"};
-std::string_view C_READY{"READY"};
-std::string_view CTRLZCR{"\x1a\r\n"};
-std::string_view C_CGNSPWRON{"AT+CGNSPWR=1"};
-std::string_view C_CGNSPWROFF{"AT+CGNSPWR=0"};
-std::string_view C_CCGNSINF{"AT+CGNSINF"};
+inline constexpr std::string_view C_AT{"AT"};
+inline constexpr std::string_view C_ATE0{"ATE0"};
+inline constexpr std::string_view C_ATE1{"ATE1"};
+inline constexpr std::string_view C_ATCFUN0{"AT+CFUN=0"};
+inline constexpr std::string_view C_ATCFUN1{"AT+CFUN=1"};
+inline constexpr std::string_view C_ATCPOWD{"AT+CPOWD=1"};
+inline constexpr std::string_view C_ATCCLK{"AT+CCLK?"};
+inline constexpr std::string_view C_ATCCLKON{"AT+CLTS=1"};
+inline constexpr std::string_view C_ATCCLKOFF{"AT+CLTS=0"};
+inline constexpr std::string_view C_ATW{"AT&W"};
+inline constexpr std::string_view C_ATCREG{"AT+CREG?"};
+inline constexpr std::string_view C_ATCSQ{"AT+CSQ"};
+inline constexpr std::string_view C_ATCPIN{"AT+CPIN?"};
+inline constexpr std::string_view C_ATCMGFON{"AT+CMGF=1"};
+inline constexpr std::string_view C_ATCMGFOFF{"AT+CMGF=0"};
+inline constexpr std::string_view C_ATCMGS{"AT+CMGS"};
+inline constexpr std::string_view C_ATCCID{"AT+CCID"};
+inline constexpr std::string_view C_ATCOPS{"AT+COPS?"};
+inline constexpr std::string_view C_ATCOPS0{"AT+COPS=0"};
+// latency key of the batched telemetry line, not sent
+inline constexpr std::string_view C_ATBATCH{"AT;"};
+inline constexpr std::string_view C_ATA{"ATA"};
+inline constexpr std::string_view C_ATH{"ATH"};
+inline constexpr std::string_view C_ATD{"ATD+"};
+inline constexpr std::string_view C_CLIPON{"AT+CLIP=1"};
+inline constexpr std::string_view C_CLIPOFF{"AT+CLIP=0"};
+inline constexpr std::string_view C_CMGD000{"AT+CMGD="};
+inline constexpr std::string_view C_CMGR000{"AT+CMGR="};
+inline constexpr std::string_view C_CSDHON{"AT+CSDH=1"};
+inline constexpr std::string_view C_CSDHOFF{"AT+CSDH=0"};
+inline constexpr std::string_view C_CNMIDIRECT{"AT+CNMI=2,2,0,0,0"};
+inline constexpr std::string_view C_CNMISTORE{"AT+CNMI=2,1,0,0,0"};
+inline constexpr std::string_view C_CMT{"+CMT:"};
+inline constexpr std::string_view C_CATPMS{"AT+CPMS?"};
+inline constexpr std::string_view C_CPMS{"CPMS"};
+inline constexpr std::string_view C_CSQ{"CSQ"};
+inline constexpr std::string_view C_CREG{"CREG"};
+inline constexpr std::string_view C_COPS{"COPS"};
+inline constexpr std::string_view C_CCLK{"CCLK"};
+inline constexpr std::string_view C_CMGR{"CMGR"};
+inline constexpr std::string_view C_CMGL{"CMGL"};
+inline constexpr std::string_view C_CMGLALL{"AT+CMGL=\"ALL\""};
+inline constexpr std::string_view C_CGNSINFA{"CGNSINF"};
+inline constexpr std::string_view C_READY{"READY"};
+inline constexpr std::string_view C_CPINA{"+CPIN:"};
+inline constexpr std::string_view C_CMEERROR{"+CME ERROR"};
+inline constexpr std::string_view C_CMSERROR{"+CMS ERROR"};
+inline constexpr std::string_view CTRLZCR{"\x1a\r\n"};
+inline constexpr std::string_view CTRLESC{"\x1b"};
+inline constexpr std::string_view C_CGNSPWRON{"AT+CGNSPWR=1"};
+inline constexpr std::string_view C_CGNSPWROFF{"AT+CGNSPWR=0"};
+inline constexpr std::string_view C_CCGNSINF{"AT+CGNSINF"};
+inline constexpr std::string_view C_CGNSTSTON{"AT+CGNSTST=1"};
+inline constexpr std::string_view C_CGNSTSTOFF{"AT+CGNSTST=0"};
+
+// modem start-up messages, see ModemBoot
+struct BootToken
+{
+    std::string_view _token;
+    uint8_t _flag;
+};
+
+constexpr BootToken C_BOOT[]{
+    {"RDY"sv, ModemBoot::rdy},
+    {"+CFUN: 1"sv, ModemBoot::cfun},
+    {"+CPIN: READY"sv, ModemBoot::cpin},
+    {"Call Ready"sv, ModemBoot::callReady},
+    {"SMS Ready"sv, ModemBoot::smsReady},
+};
+
+// hard deadline [ms] of slow commands, the others use the request maxWait
+struct CommandCeiling
+{
+    std::string_view _command;
+    uint32_t _ceiling;
+};
+
+constexpr CommandCeiling C_CEILING[]{
+    {"AT+CMGS"sv, 60000},   // submit to the network
+    {"AT+CMGD"sv, 25000},   // AT+CMGD, AT+CMGDA - storage erase
+    {"AT+CMGL"sv, 30000},   // list of the storage
+    {"AT+CFUN"sv, 15000},   // radio on / off
+    {"AT+COPS="sv, 60000},  // network selection
+};
+
+// the rest of the line is masked in the trace, see AtTrace::capturePrivate
+constexpr std::string_view C_PRIVATE[]{"+CMT:"sv, "+CMGL:"sv, "+CMGR:"sv, "+CLIP:"sv};
+
+// unsolicited result codes, "+KEY: ..." or the whole line
+constexpr std::string_view C_URC[]{"RING"sv, "CLIP"sv, "CMTI"sv, "CREG"sv, "CGNSINF"sv, "UGNSINF"sv};
 
 }
 
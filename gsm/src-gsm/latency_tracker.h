@@ -0,0 +1,163 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   latency_tracker.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+#include <cstddef>
+#include <algorithm>
+#include <string_view>
+
+namespace gsm {
+
+/**
+ * @brief observed response time per command, the deadline of the next command
+ * is derived from it instead of a fixed timeout.
+ * EWMA (alpha 1/8) + slowly decaying maximum, fixed number of commands (LRU).
+ *
+ * @tparam Slots - number of tracked commands
+ */
+template <std::size_t Slots>
+class LatencyTracker
+{
+public:
+    /**
+     * @brief successful command
+     *
+     * @param key - command name, e.g. "AT+CSQ"
+     * @param ms - time from the command to the final status
+     */
+    void record(std::string_view key, uint32_t ms)
+    {
+        auto &e = entry(key);
+        if (e._count == 0)
+        {
+            e._ewma8 = ms << _shift;
+            e._max = ms;
+        }
+        else
+        {
+            e._ewma8 = e._ewma8 - (e._ewma8 >> _shift) + ms;
+            e._max = std::max(ms, e._max - (e._max >> _decayShift));
+        }
+
+        if (e._count < UINT16_MAX)
+            e._count++;
+    }
+
+    /**
+     * @brief command timed out, the next deadline is extended
+     *
+     * @param key - command name
+     * @param ms - deadline that expired
+     */
+    void penalize(std::string_view key, uint32_t ms)
+    {
+        // unknown command is already waited for up to the ceiling
+        auto h = hash(key);
+        for (auto &e : _entries)
+        {
+            if (e._count && e._key == h)
+                e._max = std::max(e._max, ms);
+        }
+    }
+
+    /**
+     * @brief deadline for the command
+     *
+     * @param key - command name
+     * @param floor - minimal deadline [ms]
+     * @param ceiling - maximal deadline [ms], used until enough samples are collected
+     * @return uint32_t - [ms]
+     */
+    uint32_t deadline(std::string_view key, uint32_t floor, uint32_t ceiling) const
+    {
+        auto e = find(hash(key));
+        if (!e || e->_count < _minSamples)
+            return ceiling;
+
+        auto learned = std::max((e->_ewma8 >> _shift) * _ewmaFactor, e->_max + (e->_max >> 1));
+        return std::clamp(learned, std::min(floor, ceiling), ceiling);
+    }
+
+private:
+    static constexpr uint32_t _shift{3};        ///< EWMA alpha 1/8
+    static constexpr uint32_t _decayShift{4};   ///< maximum decays by 1/16 per sample
+    static constexpr uint32_t _ewmaFactor{4};   ///< deadline >= 4x average
+    static constexpr uint16_t _minSamples{3};   ///< samples before the learned value is used
+
+    struct Entry
+    {
+        uint32_t _key{0};       ///< command name hash
+        uint32_t _ewma8{0};     ///< average x8 [ms]
+        uint32_t _max{0};       ///< decaying maximum [ms]
+        uint16_t _count{0};     ///< samples
+        uint32_t _used{0};      ///< last use, LRU
+    };
+
+    /**
+     * @brief FNV-1a
+     *
+     * @param key
+     * @return constexpr uint32_t
+     */
+    static constexpr uint32_t hash(std::string_view key)
+    {
+        uint32_t h = 2166136261u;
+        for (auto c : key)
+        {
+            h ^= (uint8_t)c;
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    const Entry *find(uint32_t key) const
+    {
+        for (const auto &e : _entries)
+        {
+            if (e._count && e._key == key)
+                return &e;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief entry of the command, the least recently used one is replaced
+     *
+     * @param key
+     * @return Entry&
+     */
+    Entry &entry(std::string_view key)
+    {
+        auto h = hash(key);
+        auto rc = &_entries[0];
+        for (auto &e : _entries)
+        {
+            if (e._count && e._key == h)
+            {
+                rc = &e;
+                break;
+            }
+            if (e._used < rc->_used)
+                rc = &e;
+        }
+
+        if (rc->_key != h || !rc->_count)
+        {
+            *rc = Entry{};
+            rc->_key = h;
+        }
+        rc->_used = ++_clock;
+        return *rc;
+    }
+
+    Entry _entries[Slots];
+    uint32_t _clock{0};
+};
+
+} //namespace gsm
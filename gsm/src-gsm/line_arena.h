@@ -0,0 +1,122 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   line_arena.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+#include <cstddef>
+#include <string_view>
+
+namespace gsm {
+
+/**
+ * @brief fixed-capacity storage of response lines.
+ * Characters are appended directly into the arena (open line), a finished line
+ * is committed as a string_view into the same memory - no heap, no copies.
+ *
+ * @tparam Lines - maximum number of committed lines
+ * @tparam Bytes - arena size shared by all lines
+ */
+template <std::size_t Lines, std::size_t Bytes>
+class LineArena
+{
+public:
+    /**
+     * @brief drop all lines including the open one
+     *
+     */
+    void clear()
+    {
+        _count = 0;
+        _used = 0;
+        _open = 0;
+    }
+
+    /**
+     * @brief append char to the open line
+     *
+     * @param c
+     * @return true - stored
+     * @return false - arena is full, char is dropped
+     */
+    bool append(char c)
+    {
+        if (_used + _open >= Bytes)
+            return false;
+        _data[_used + _open] = c;
+        _open++;
+        return true;
+    }
+
+    /**
+     * @brief the open (not yet committed) line
+     *
+     * @return std::string_view
+     */
+    std::string_view current() const
+    {
+        return std::string_view(&_data[_used], _open);
+    }
+
+    /**
+     * @brief remove last chars from the open line
+     *
+     * @param count
+     */
+    void discard(std::size_t count)
+    {
+        _open = (count < _open) ? _open - count : 0;
+    }
+
+    /**
+     * @brief drop the open line
+     *
+     */
+    void reset()
+    {
+        _open = 0;
+    }
+
+    /**
+     * @brief close the open line and store it as the next response line
+     *
+     * @return true - stored
+     * @return false - no free line slot, the open line is dropped
+     */
+    bool commit()
+    {
+        bool rc = false;
+        if (_count < Lines)
+        {
+            _lines[_count++] = current();
+            _used += _open;
+            rc = true;
+        }
+        _open = 0;
+        return rc;
+    }
+
+    std::size_t size() const { return _count; }
+    bool empty() const { return _count == 0; }
+    bool full() const { return _count == Lines; }
+    const std::string_view *begin() const { return &_lines[0]; }
+    const std::string_view *end() const { return &_lines[_count]; }
+    const std::string_view &operator[](std::size_t index) const { return _lines[index]; }
+    const std::string_view &back() const { return _lines[_count - 1]; }
+
+    static constexpr std::size_t capacity() { return Lines; }
+    static constexpr std::size_t bytes() { return Bytes; }
+
+private:
+    char _data[Bytes];                  ///< arena
+    std::string_view _lines[Lines];     ///< committed lines, views into the arena
+    std::size_t _count{0};              ///< number of committed lines
+    std::size_t _used{0};               ///< bytes used by committed lines
+    std::size_t _open{0};               ///< length of the open line
+};
+
+} //namespace gsm
@@ -0,0 +1,270 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   nmea_parser.cpp
+/// @author Petr Vanek
+
+#include "nmea_parser.h"
+#include "src-utils/time_utils.h"
+
+namespace gsm {
+
+namespace {
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/**
+ * @brief fixed digits, e.g. "hhmmss"
+ *
+ */
+bool digits(std::string_view str, std::size_t pos, std::size_t cnt, int8_t &value)
+{
+    if (str.size() < pos + cnt)
+        return false;
+
+    int rc = 0;
+    for (std::size_t i = pos; i < pos + cnt; i++)
+    {
+        if (str[i] < '0' || str[i] > '9')
+            return false;
+        rc = rc * 10 + (str[i] - '0');
+    }
+    value = (int8_t)rc;
+    return true;
+}
+
+/**
+ * @brief "-123.4567" -> -1234567 for 4 decimals, more decimals are cut
+ *
+ */
+bool decimal(std::string_view str, uint8_t decimals, int64_t &value)
+{
+    bool negative = !str.empty() && str.front() == '-';
+    if (negative)
+        str.remove_prefix(1);
+    if (str.empty())
+        return false;
+
+    int64_t rc = 0;
+    int fraction = -1;
+    for (auto c : str)
+    {
+        if (c == '.' && fraction < 0)
+        {
+            fraction = 0;
+            continue;
+        }
+        if (c < '0' || c > '9')
+            return false;
+        if (fraction >= decimals)
+            continue;
+        rc = rc * 10 + (c - '0');
+        if (fraction >= 0)
+            fraction++;
+    }
+    for (int i = (fraction < 0) ? 0 : fraction; i < decimals; i++)
+        rc *= 10;
+
+    value = negative ? -rc : rc;
+    return true;
+}
+
+/**
+ * @brief "ddmm.mmmmm" / "dddmm.mmmmm" and hemisphere -> [1e-7 deg]
+ *
+ */
+bool coordinate(std::string_view str, std::string_view hemisphere, int32_t &value)
+{
+    int64_t raw = 0;
+    if (hemisphere.empty() || !decimal(str, 5, raw))
+        return false;
+
+    // degrees * 1e7 + minutes * 1e5 / 60 * 1e2
+    int64_t rc = (raw / 10000000) * 10000000 + ((raw % 10000000) * 5 + 1) / 3;
+    value = (int32_t)((hemisphere.front() == 'S' || hemisphere.front() == 'W') ? -rc : rc);
+    return true;
+}
+
+} // namespace
+
+bool NmeaParser::push(std::string_view data)
+{
+    bool rc = false;
+    for (auto c : data)
+        rc |= push(c);
+    return rc;
+}
+
+bool NmeaParser::push(char c)
+{
+    bool rc = false;
+    do
+    {
+        if (c == '$')
+        {
+            // the start of the sentence, a broken one is forgotten
+            if (_step == Step::data || _step == Step::checksum)
+                _checksumErrors++;
+            _step = Step::data;
+            _length = 0;
+            _sum = 0;
+            _expected = 0;
+            _digits = 0;
+            break;
+        }
+
+        switch (_step)
+        {
+        case Step::idle:
+        case Step::skip:
+            if (c == '\n')
+                _step = Step::idle;
+            break;
+
+        case Step::data:
+            if (c == '*')
+            {
+                _step = Step::checksum;
+                break;
+            }
+
+            if (c == '\r' || c == '\n' || _length == sizeof(_buffer))
+            {
+                _checksumErrors++;
+                reset();
+                break;
+            }
+
+            _sum ^= (uint8_t)c;
+            _buffer[_length++] = c;
+
+            // "GPRMC," - only RMC and GGA are evaluated
+            if (_length == 6)
+            {
+                std::string_view type(_buffer + 2, 4);
+                if (type != "RMC," && type != "GGA,")
+                    _step = Step::skip;
+            }
+            break;
+
+        case Step::checksum:
+        {
+            auto value = hexValue(c);
+            if (value < 0)
+            {
+                _checksumErrors++;
+                reset();
+                break;
+            }
+
+            _expected = (uint8_t)(_expected << 4 | value);
+            if (++_digits < 2)
+                break;
+
+            rc = evaluate();
+            _step = Step::skip;     // to the line end
+            break;
+        }
+        }
+    } while (false);
+    return rc;
+}
+
+void NmeaParser::reset()
+{
+    _step = Step::skip;
+    _length = 0;
+}
+
+bool NmeaParser::evaluate()
+{
+    if (_expected != _sum || _length < 6)
+    {
+        _checksumErrors++;
+        return false;
+    }
+
+    _sentences++;
+    if (_buffer[2] == 'R')
+        return rmc();
+
+    gga();
+    return false;
+}
+
+std::string_view NmeaParser::field(std::size_t index) const
+{
+    std::string_view sentence(_buffer, _length);
+    std::size_t pos = 0;
+    for (; index && pos != std::string_view::npos; index--)
+    {
+        pos = sentence.find(',', pos);
+        if (pos != std::string_view::npos)
+            pos++;
+    }
+    if (pos == std::string_view::npos)
+        return {};
+
+    auto end = sentence.find(',', pos);
+    return sentence.substr(pos, (end == std::string_view::npos) ? std::string_view::npos : end - pos);
+}
+
+bool NmeaParser::rmc()
+{
+    // GPRMC,hhmmss.sss,A,ddmm.mmmm,N,dddmm.mmmm,E,knots,course,ddmmyy,,,A
+    bool rc = false;
+    do
+    {
+        auto time = field(1);
+        auto date = field(9);
+        datetime_t tm{};
+        int8_t year = 0;
+        if (!digits(time, 0, 2, tm.hour) || !digits(time, 2, 2, tm.min) || !digits(time, 4, 2, tm.sec) ||
+            !digits(date, 0, 2, tm.day) || !digits(date, 2, 2, tm.month) || !digits(date, 4, 2, year))
+            break;
+
+        int64_t seconds = 0;
+        decimal(time.substr(4), 3, seconds);
+        tm.year = (int16_t)(2000 + year);
+        TimeUtils::updateDayOfWeek(tm);
+        _fix._utc = tm;
+        _fix._ms = (uint16_t)(seconds % 1000);
+        rc = true;
+
+        _fix._valid = field(2) == "A";
+        if (!_fix._valid)
+            break;
+
+        coordinate(field(3), field(4), _fix._latitude);
+        coordinate(field(5), field(6), _fix._longitude);
+
+        int64_t value = 0;
+        if (decimal(field(7), 3, value))
+            _fix._speed = (uint32_t)((value * 514444 + 5000000) / 10000000);   // knots -> cm/s
+        if (decimal(field(8), 2, value))
+            _fix._course = (uint16_t)value;
+    } while (false);
+    return rc;
+}
+
+void NmeaParser::gga()
+{
+    // GPGGA,hhmmss.sss,ddmm.mmmm,N,dddmm.mmmm,E,quality,satellites,hdop,altitude,M,...
+    int64_t value = 0;
+    _fix._quality = decimal(field(6), 0, value) ? (uint8_t)value : 0;
+    _fix._satellites = decimal(field(7), 0, value) ? (uint8_t)value : 0;
+    if (_fix._quality && decimal(field(9), 2, value))
+        _fix._altitude = (int32_t)value;
+}
+
+} // namespace gsm
@@ -0,0 +1,99 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   nmea_parser.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+#include <cstddef>
+#include <string_view>
+#include "pico/util/datetime.h"
+
+namespace gsm {
+
+/**
+ * @brief GNSS fix from the NMEA stream, fixed point values
+ *
+ */
+struct GnssFix
+{
+    datetime_t _utc{};                  ///< RMC date and time
+    uint16_t _ms{0};                    ///< fraction of the second of _utc
+    int32_t _latitude{0};               ///< [1e-7 deg], north positive
+    int32_t _longitude{0};              ///< [1e-7 deg], east positive
+    int32_t _altitude{0};               ///< [cm] above the mean sea level, GGA
+    uint32_t _speed{0};                 ///< [cm/s] over ground
+    uint16_t _course{0};                ///< [1e-2 deg] over ground
+    uint8_t _satellites{0};             ///< used satellites, GGA
+    uint8_t _quality{0};                ///< GGA fix quality, 0 - no fix
+    bool _valid{false};                 ///< RMC status A
+    uint64_t _stamp{0};                 ///< [us] local time of the RMC reception, set by GSM
+};
+
+/**
+ * @brief incremental NMEA 0183 parser, RMC and GGA sentences of any talker (GP, GN, GL ...).
+ * Bytes are pushed as they arrive, the checksum is computed on the fly and the sentence
+ * is evaluated after its checksum digits. Other sentences are dropped after the address field.
+ *
+ */
+class NmeaParser
+{
+public:
+    /**
+     * @brief next received byte
+     *
+     * @param c
+     * @return true - RMC completed, the new fix (time) is available
+     */
+    bool push(char c);
+
+    /**
+     * @brief the whole chunk
+     *
+     * @param data
+     * @return true - at least one RMC completed
+     */
+    bool push(std::string_view data);
+
+    /**
+     * @brief the last fix, time valid after the first RMC with a date
+     *
+     * @return const GnssFix&
+     */
+    const GnssFix &fix() const { return _fix; }
+
+    uint32_t sentences() const { return _sentences; }           ///< RMC and GGA with the valid checksum
+    uint32_t checksumErrors() const { return _checksumErrors; }  ///< broken or too long sentences
+
+private:
+    static constexpr std::size_t _maxSentence{82};   ///< NMEA 0183 limit including "$" and CRLF
+
+    enum class Step
+    {
+        idle,       ///< waiting for '$'
+        data,       ///< between '$' and '*'
+        checksum,   ///< two hex digits
+        skip        ///< not interesting or broken sentence, to the line end
+    };
+
+    void reset();
+    bool evaluate();
+    bool rmc();
+    void gga();
+    std::string_view field(std::size_t index) const;
+
+    Step _step{Step::idle};
+    char _buffer[_maxSentence];
+    std::size_t _length{0};
+    uint8_t _sum{0};                    ///< XOR of the data
+    uint8_t _expected{0};               ///< received checksum
+    uint8_t _digits{0};                 ///< received checksum digits
+    GnssFix _fix;
+    uint32_t _sentences{0};
+    uint32_t _checksumErrors{0};
+};
+
+} // namespace gsm
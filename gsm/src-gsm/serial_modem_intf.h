@@ -8,6 +8,8 @@
 #pragma once
 
 #include <inttypes.h>
+#include <cstddef>
+#include <string_view>
 
 namespace gsm {
 
@@ -16,12 +18,37 @@ class ISerialModem {
 public:
 
     virtual bool isReadable() = 0;
-    virtual bool isWritable() = 0;
-    virtual void putch(char c) = 0;
-    virtual char getc() = 0;
+
+    /**
+     * @brief non-blocking bulk read, copies received bytes up to and including the delimiter
+     *
+     * @param buffer - output
+     * @param size - output capacity
+     * @param delimiter - reading stops after this char, typically end of line
+     * @return std::size_t - number of copied bytes, 0 if nothing is received
+     */
+    virtual std::size_t read(char *buffer, std::size_t size, char delimiter) = 0;
+
+    /**
+     * @brief non-blocking bulk write, sends as much as the transmitter accepts now
+     *
+     * @param data - data to send
+     * @return std::size_t - number of accepted bytes
+     */
+    virtual std::size_t write(std::string_view data) = 0;
+
     virtual void delay(uint16_t ms) = 0;
     virtual uint64_t getus() = 0;
 
+    /**
+     * @brief blocks until received data is available or the time expires,
+     * the implementation may suspend the caller instead of polling isReadable()
+     *
+     * @param maxWait - maximum wait in ms
+     * @return true - data available
+     */
+    virtual bool waitReadable(uint32_t maxWait) = 0;
+
     virtual void hardwareInit() = 0; 
     virtual void modemInit() = 0; 
 };
@@ -0,0 +1,276 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   sms_outbox.cpp
+/// @author Petr Vanek
+
+#include <memory.h>
+#include <algorithm>
+#include "sms_outbox.h"
+#include "gsm_commands.h"
+
+namespace gsm {
+
+namespace {
+
+constexpr uint8_t C_ESC{0x1b};     ///< GSM 03.38 extension table
+constexpr char C_HEX[]{"0123456789ABCDEF"};
+
+void appendHex(std::string &out, uint8_t value)
+{
+    out += C_HEX[value >> 4];
+    out += C_HEX[value & 0x0f];
+}
+
+// length of the text in septets, see SmsOutbox::toSeptets
+std::size_t septetCount(std::string_view text)
+{
+    std::size_t rc = text.size();
+    for (auto c : text)
+    {
+        if (std::string_view("^{}\\[~]|").find(c) != std::string_view::npos)
+            rc++;
+    }
+    return rc;
+}
+
+} // namespace
+
+bool SmsOutbox::send(std::string_view phoneNumber, std::string_view text)
+{
+    bool rc = false;
+    do
+    {
+        if (phoneNumber.empty() || text.empty())
+            break;
+
+        // the reply to the same number, not started yet; a part may end one septet short, see prepare
+        if (!_queue.empty())
+        {
+            auto &last = _queue.back();
+            if (last._parts == 0 && last._number == phoneNumber &&
+                septetCount(last._text) + 1 + septetCount(text) <= _maxParts * (_partSeptets - 1))
+            {
+                last._text += '\n';
+                last._text += text;
+                _merged++;
+                rc = true;
+                break;
+            }
+        }
+
+        if (_queue.size() >= _maxMessages)
+            break;
+
+        Outgoing msg;
+        msg._number = phoneNumber;
+        msg._text = text;
+        _queue.push_back(std::move(msg));
+        rc = true;
+    } while (false);
+    return rc;
+}
+
+void SmsOutbox::poll(uint64_t nowUs)
+{
+    _now = nowUs;
+    do
+    {
+        if (_inFlight || _queue.empty())
+            break;
+
+        auto &msg = _queue.front();
+        if (nowUs < msg._notBefore)
+            break;
+
+        if (msg._parts == 0)
+            prepare(msg);
+
+        // engine queue full, next poll
+        _inFlight = _gsm.submit(request(msg));
+    } while (false);
+}
+
+uint64_t SmsOutbox::nextPollUs() const
+{
+    return (_inFlight || _queue.empty()) ? UINT64_MAX : _queue.front()._notBefore;
+}
+
+void SmsOutbox::prepare(Outgoing &msg)
+{
+    msg._septets = toSeptets(msg._text);
+    if (msg._septets.size() <= _singleSeptets)
+    {
+        msg._parts = 1;
+        return;
+    }
+
+    // escape pair is not split between parts
+    std::size_t parts = 0, pos = 0;
+    while (pos < msg._septets.size() && parts < _maxParts)
+    {
+        auto cnt = std::min(_partSeptets, msg._septets.size() - pos);
+        if (pos + cnt < msg._septets.size() && msg._septets[pos + cnt - 1] == C_ESC)
+            cnt--;
+        pos += cnt;
+        parts++;
+    }
+    msg._septets.resize(pos);   // longer text is cut
+    msg._parts = (uint8_t)parts;
+    msg._reference = _reference++;
+}
+
+AtRequest SmsOutbox::request(const Outgoing &msg)
+{
+    AtRequest rc;
+    rc._callback = [this](bool success, ATParser &)
+    {
+        done(success);
+    };
+
+    if (msg._parts == 1)
+    {
+        // one SMS in the text mode, as GSM::sendSMS
+        rc._command = gsm_cmd::C_ATCMGS;
+        rc._command += "=\"";
+        rc._command += msg._number;
+        rc._command += '"';
+        rc._payload = msg._text;
+        rc._textMode = true;
+        return rc;
+    }
+
+    // part boundaries, see prepare
+    std::size_t pos = 0, cnt = 0;
+    for (uint8_t i = 0; i <= msg._part; i++)
+    {
+        pos += cnt;
+        cnt = std::min(_partSeptets, msg._septets.size() - pos);
+        if (pos + cnt < msg._septets.size() && msg._septets[pos + cnt - 1] == C_ESC)
+            cnt--;
+    }
+
+    auto pdu = submitPdu(msg._number, msg._septets.data() + pos, cnt, msg._reference, msg._parts, msg._part + 1);
+
+    // the length excludes the SMSC octet "00"
+    rc._command = gsm_cmd::C_ATCMGS;
+    rc._command += '=';
+    rc._command += std::to_string(pdu.size() / 2);
+    rc._payload = "00";
+    rc._payload += pdu;
+    rc._textMode = false;
+    return rc;
+}
+
+void SmsOutbox::done(bool success)
+{
+    _inFlight = false;
+    do
+    {
+        if (_queue.empty())
+            break;
+
+        auto &msg = _queue.front();
+        if (!success)
+        {
+            msg._attempts++;
+            if (msg._attempts < _maxAttempts)
+            {
+                _retries++;
+                msg._notBefore = _now + ((uint64_t)_backoffMs << (msg._attempts - 1)) * 1000ull;
+                break;
+            }
+
+            // the rest of the message is useless
+            _failed++;
+        }
+        else
+        {
+            msg._attempts = 0;
+            if (++msg._part < msg._parts)
+                break;
+            _sent++;
+        }
+        _queue.pop_front();
+    } while (false);
+}
+
+std::vector<uint8_t> SmsOutbox::toSeptets(std::string_view text)
+{
+    std::vector<uint8_t> rc;
+    rc.reserve(text.size());
+    for (auto c : text)
+    {
+        switch (c)
+        {
+        case '@': rc.push_back(0x00); break;
+        case '$': rc.push_back(0x02); break;
+        case '_': rc.push_back(0x11); break;
+        case '\n': rc.push_back(0x0a); break;
+        case '\r': rc.push_back(0x0d); break;
+        case '^': rc.insert(rc.end(), {C_ESC, 0x14}); break;
+        case '{': rc.insert(rc.end(), {C_ESC, 0x28}); break;
+        case '}': rc.insert(rc.end(), {C_ESC, 0x29}); break;
+        case '\\': rc.insert(rc.end(), {C_ESC, 0x2f}); break;
+        case '[': rc.insert(rc.end(), {C_ESC, 0x3c}); break;
+        case '~': rc.insert(rc.end(), {C_ESC, 0x3d}); break;
+        case ']': rc.insert(rc.end(), {C_ESC, 0x3e}); break;
+        case '|': rc.insert(rc.end(), {C_ESC, 0x40}); break;
+        default:
+            // the rest of the printable ascii is the same, except of '`'
+            rc.push_back((c >= 0x20 && c < 0x7f && c != '`') ? (uint8_t)c : (uint8_t)'?');
+            break;
+        }
+    }
+    return rc;
+}
+
+std::string SmsOutbox::submitPdu(std::string_view number, const uint8_t *septets, std::size_t count, uint8_t reference, uint8_t parts, uint8_t part)
+{
+    std::string rc;
+    bool international = !number.empty() && number.front() == '+';
+    if (international)
+        number.remove_prefix(1);
+
+    // SMS-SUBMIT with UDHI, message reference set by the modem
+    appendHex(rc, 0x41);
+    appendHex(rc, 0x00);
+
+    // destination address, semi-octets with swapped nibbles
+    appendHex(rc, (uint8_t)number.size());
+    appendHex(rc, international ? 0x91 : 0x81);
+    for (std::size_t i = 0; i < number.size(); i += 2)
+    {
+        rc += (i + 1 < number.size()) ? number[i + 1] : 'F';
+        rc += number[i];
+    }
+
+    // protocol identifier, GSM 7 bit data coding
+    appendHex(rc, 0x00);
+    appendHex(rc, 0x00);
+
+    // user data: UDH concatenated 8-bit reference, 1 fill bit, packed septets
+    const uint8_t udh[]{0x05, 0x00, 0x03, reference, parts, part};
+    constexpr std::size_t udhSeptets = 7;
+    appendHex(rc, (uint8_t)(udhSeptets + count));
+
+    std::vector<uint8_t> ud(((udhSeptets + count) * 7 + 7) / 8, 0);
+    memcpy(ud.data(), udh, sizeof(udh));
+    std::size_t bit = udhSeptets * 7;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        for (int b = 0; b < 7; b++, bit++)
+        {
+            if (septets[i] & (1 << b))
+                ud[bit / 8] |= (uint8_t)(1 << (bit % 8));
+        }
+    }
+
+    for (auto x : ud)
+        appendHex(rc, x);
+
+    return rc;
+}
+
+} // namespace gsm
@@ -0,0 +1,141 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   sms_outbox.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include "gsm.h"
+
+namespace gsm {
+
+/**
+ * @brief bounded queue of outgoing SMS, sent in the background by the GSM request engine.
+ * Consecutive messages to the same number are merged, a text longer than one SMS is sent
+ * as a concatenated message (PDU mode, UDH), a failed part is repeated with backoff.
+ *
+ */
+class SmsOutbox
+{
+public:
+    explicit SmsOutbox(GSM &gsm) : _gsm(gsm) {}
+
+    /**
+     * @brief queue the message
+     *
+     * @param phoneNumber - recipient, e.g. "+420123456789"
+     * @param text - ascii text, characters outside of the GSM alphabet are replaced by '?'
+     * @return true - queued or merged with the previous message to the same number
+     * @return false - queue is full or invalid parameters
+     */
+    bool send(std::string_view phoneNumber, std::string_view text);
+
+    /**
+     * @brief starts the next part if nothing is being sent, called from the task loop
+     *
+     * @param nowUs - current time [us]
+     */
+    void poll(uint64_t nowUs);
+
+    /**
+     * @brief the next poll() that can start a part, the completion of the part in progress
+     * is reported by the engine
+     *
+     * @return uint64_t - [us], UINT64_MAX - nothing to start
+     */
+    uint64_t nextPollUs() const;
+
+    /**
+     * @brief number of queued messages including the one being sent
+     *
+     * @return std::size_t
+     */
+    std::size_t pending() const { return _queue.size(); }
+
+    uint32_t sent() const { return _sent; }         ///< messages delivered to the network
+    uint32_t merged() const { return _merged; }     ///< messages appended to the previous one
+    uint32_t retries() const { return _retries; }   ///< repeated parts
+    uint32_t failed() const { return _failed; }     ///< messages dropped after all attempts
+
+private:
+    static constexpr std::size_t _maxMessages{4};       ///< queue capacity
+    static constexpr std::size_t _maxParts{4};          ///< longest concatenated message
+    static constexpr std::size_t _singleSeptets{160};   ///< one SMS
+    static constexpr std::size_t _partSeptets{153};     ///< one part of the concatenated SMS, 7 septets of UDH
+    static constexpr uint8_t _maxAttempts{3};           ///< per part
+    static constexpr uint32_t _backoffMs{5000};         ///< doubled with every attempt
+
+    struct Outgoing
+    {
+        std::string _number;                ///< recipient
+        std::string _text;                  ///< ascii text
+        std::vector<uint8_t> _septets;      ///< GSM 7 bit text, prepared by the first send
+        uint8_t _reference{0};              ///< concatenated message reference
+        uint8_t _parts{0};                  ///< 0 - not started
+        uint8_t _part{0};                   ///< the part being sent
+        uint8_t _attempts{0};               ///< failed attempts of the part
+        uint64_t _notBefore{0};             ///< backoff [us]
+    };
+
+    /**
+     * @brief splits the text into parts at the first send, the message cannot be merged any more
+     *
+     * @param msg
+     */
+    void prepare(Outgoing &msg);
+
+    /**
+     * @brief AT request of the current part
+     *
+     * @param msg
+     * @return AtRequest
+     */
+    AtRequest request(const Outgoing &msg);
+
+    /**
+     * @brief completion of the part
+     *
+     * @param success
+     */
+    void done(bool success);
+
+    /**
+     * @brief ascii to the GSM 03.38 default alphabet, extension characters are escaped
+     *
+     * @param text
+     * @return std::vector<uint8_t> - septets
+     */
+    static std::vector<uint8_t> toSeptets(std::string_view text);
+
+    /**
+     * @brief SMS-SUBMIT TPDU of one concatenated part, hex encoded
+     *
+     * @param number - recipient
+     * @param septets - text of the part
+     * @param count - number of septets
+     * @param reference - concatenated message reference
+     * @param parts - number of parts
+     * @param part - 1..parts
+     * @return std::string - hex TPDU
+     */
+    static std::string submitPdu(std::string_view number, const uint8_t *septets, std::size_t count, uint8_t reference, uint8_t parts, uint8_t part);
+
+    GSM &_gsm;
+    std::deque<Outgoing> _queue;    ///< the front one is being sent
+    bool _inFlight{false};          ///< part request queued in the engine
+    uint64_t _now{0};               ///< time of the last poll [us]
+    uint8_t _reference{0};          ///< the next concatenated message reference
+    uint32_t _sent{0};
+    uint32_t _merged{0};
+    uint32_t _retries{0};
+    uint32_t _failed{0};
+};
+
+} // namespace gsm
@@ -0,0 +1,263 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   sms_pdu.cpp
+/// @author Petr Vanek
+
+#include <stdio.h>
+#include <vector>
+#include "sms_pdu.h"
+
+namespace gsm {
+
+namespace {
+
+enum class Alphabet : uint8_t
+{
+    gsm7,
+    data8,
+    ucs2,
+    unknown
+};
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+bool toOctets(std::string_view hex, std::vector<uint8_t> &out)
+{
+    if (hex.empty() || hex.size() % 2)
+        return false;
+
+    out.reserve(hex.size() / 2);
+    for (std::size_t i = 0; i < hex.size(); i += 2)
+    {
+        auto hi = hexValue(hex[i]), lo = hexValue(hex[i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        out.push_back((uint8_t)((hi << 4) | lo));
+    }
+    return true;
+}
+
+// data coding scheme, 3GPP TS 23.038 chapter 4
+Alphabet alphabet(uint8_t dcs)
+{
+    if ((dcs & 0x80) == 0x00)
+    {
+        // general data coding, compressed text is not supported
+        if (dcs & 0x20)
+            return Alphabet::unknown;
+        return static_cast<Alphabet>((dcs >> 2) & 0x03);
+    }
+    if ((dcs & 0xf0) == 0xf0)
+        return (dcs & 0x04) ? Alphabet::data8 : Alphabet::gsm7;
+    if ((dcs & 0xf0) == 0xe0)
+        return Alphabet::ucs2;
+    if ((dcs & 0xe0) == 0xc0)
+        return Alphabet::gsm7;
+    return Alphabet::unknown;
+}
+
+// GSM 03.38, the ascii subset of SmsOutbox::toSeptets
+char fromSeptet(uint8_t septet, bool escaped)
+{
+    if (escaped)
+    {
+        switch (septet)
+        {
+        case 0x14: return '^';
+        case 0x28: return '{';
+        case 0x29: return '}';
+        case 0x2f: return '\\';
+        case 0x3c: return '[';
+        case 0x3d: return '~';
+        case 0x3e: return ']';
+        case 0x40: return '|';
+        default: return '?';
+        }
+    }
+
+    switch (septet)
+    {
+    case 0x00: return '@';
+    case 0x02: return '$';
+    case 0x11: return '_';
+    case 0x0a: return '\n';
+    case 0x0d: return '\r';
+    // national characters at the ascii positions
+    case 0x24: case 0x40: case 0x5b: case 0x5c: case 0x5d: case 0x5e: case 0x5f: case 0x60:
+    case 0x7b: case 0x7c: case 0x7d: case 0x7e: case 0x7f:
+        return '?';
+    default:
+        return (septet >= 0x20) ? (char)septet : '?';
+    }
+}
+
+char fromCode(uint16_t code)
+{
+    return ((code >= 0x20 && code < 0x7f) || code == '\n' || code == '\r') ? (char)code : '?';
+}
+
+// packed septets, LSB first, the first one at the septet boundary 'first'
+std::string unpack(const uint8_t *data, std::size_t octets, std::size_t first, std::size_t count)
+{
+    std::string rc;
+    rc.reserve(count);
+    bool escaped = false;
+    for (std::size_t i = first; i < first + count; i++)
+    {
+        auto bit = i * 7;
+        auto pos = bit / 8, shift = bit % 8;
+        if (pos >= octets)
+            break;
+
+        unsigned value = data[pos] >> shift;
+        if (shift > 1 && pos + 1 < octets)
+            value |= (unsigned)data[pos + 1] << (8 - shift);
+        auto septet = (uint8_t)(value & 0x7f);
+
+        if (!escaped && septet == 0x1b)
+        {
+            escaped = true;
+            continue;
+        }
+        rc += fromSeptet(septet, escaped);
+        escaped = false;
+    }
+    return rc;
+}
+
+} // namespace
+
+std::optional<SmsDeliver> decodeDeliver(std::string_view hex)
+{
+    std::optional<SmsDeliver> rc;
+    do
+    {
+        std::vector<uint8_t> pdu;
+        if (!toOctets(hex, pdu))
+            break;
+
+        std::size_t pos = 0;
+        auto octet = [&pdu, &pos](uint8_t &value)
+        {
+            if (pos >= pdu.size())
+                return false;
+            value = pdu[pos++];
+            return true;
+        };
+
+        // SMSC address
+        uint8_t smsc = 0;
+        if (!octet(smsc))
+            break;
+        pos += smsc;
+
+        // message type indicator of SMS-DELIVER
+        uint8_t first = 0;
+        if (!octet(first) || (first & 0x03) != 0x00)
+            break;
+
+        // originator address, the length in semi-octets
+        uint8_t digits = 0, toa = 0;
+        if (!octet(digits) || !octet(toa))
+            break;
+        std::size_t address = (digits + 1) / 2;
+        if (pos + address > pdu.size())
+            break;
+
+        SmsDeliver sms;
+        if ((toa & 0x70) == 0x50)
+        {
+            // alphanumeric sender, packed septets
+            sms._number = unpack(pdu.data() + pos, address, 0, digits * 4 / 7);
+        }
+        else
+        {
+            if ((toa & 0x70) == 0x10)
+                sms._number += '+';
+            for (std::size_t i = 0; i < digits; i++)
+            {
+                auto value = pdu[pos + i / 2];
+                auto digit = (i & 1) ? value >> 4 : value & 0x0f;
+                if (digit > 9)
+                    break;
+                sms._number += (char)('0' + digit);
+            }
+        }
+        pos += address;
+
+        // protocol identifier, data coding scheme
+        uint8_t pid = 0, dcs = 0;
+        if (!octet(pid) || !octet(dcs))
+            break;
+        auto coding = alphabet(dcs);
+        if (coding == Alphabet::unknown)
+            break;
+
+        // service centre time stamp, semi-octets with swapped nibbles, the zone in quarters of an hour
+        if (pos + 7 > pdu.size())
+            break;
+        auto bcd = [&pdu, pos](std::size_t i)
+        {
+            return (unsigned)((pdu[pos + i] & 0x0f) * 10 + (pdu[pos + i] >> 4));
+        };
+        auto zone = pdu[pos + 6];
+        char stamp[24];
+        snprintf(stamp, sizeof(stamp), "%02u/%02u/%02u,%02u:%02u:%02u%c%02u", bcd(0), bcd(1), bcd(2), bcd(3), bcd(4), bcd(5),
+                 (zone & 0x08) ? '-' : '+', (unsigned)((zone & 0x07) * 10 + (zone >> 4)));
+        sms._stamp = stamp;
+        pos += 7;
+
+        // user data, the length in septets for GSM 7 bit, otherwise in octets
+        uint8_t udl = 0;
+        if (!octet(udl))
+            break;
+        std::size_t octets = (coding == Alphabet::gsm7) ? (udl * 7 + 7) / 8 : udl;
+        if (pos + octets > pdu.size())
+            break;
+        const uint8_t *ud = pdu.data() + pos;
+
+        // user data header, e.g. the concatenated SMS parts, each part is delivered alone
+        std::size_t header = 0;
+        if (first & 0x40)
+        {
+            if (octets == 0 || (std::size_t)ud[0] + 1 > octets)
+                break;
+            header = ud[0] + 1;
+        }
+
+        if (coding == Alphabet::gsm7)
+        {
+            // the text starts at the septet boundary behind the header
+            std::size_t skip = (header * 8 + 6) / 7;
+            if (skip > udl)
+                break;
+            sms._text = unpack(ud, octets, skip, udl - skip);
+        }
+        else if (coding == Alphabet::ucs2)
+        {
+            for (std::size_t i = header; i + 1 < octets; i += 2)
+                sms._text += fromCode((uint16_t)((ud[i] << 8) | ud[i + 1]));
+        }
+        else
+        {
+            for (std::size_t i = header; i < octets; i++)
+                sms._text += fromCode(ud[i]);
+        }
+
+        rc = std::move(sms);
+    } while (false);
+    return rc;
+}
+
+} // namespace gsm
@@ -0,0 +1,36 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   sms_pdu.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace gsm {
+
+/**
+ * @brief received SMS, the text mode form of its fields
+ *
+ */
+struct SmsDeliver
+{
+    std::string _number;    ///< originator, "+420123456789" or the alphanumeric sender
+    std::string _stamp;     ///< service centre time stamp, "yy/MM/dd,hh:mm:ss+zz" as +CMT in the text mode
+    std::string _text;      ///< GSM 7 bit, UCS2 and 8-bit data as ascii, other characters '?'
+};
+
+/**
+ * @brief SMS-DELIVER of +CMT in the PDU mode (AT+CMGF=0), 3GPP TS 23.040
+ *
+ * @param hex - the PDU line, SMSC address first
+ * @return std::optional<SmsDeliver> - std::nullopt if the PDU is not a valid SMS-DELIVER
+ */
+std::optional<SmsDeliver> decodeDeliver(std::string_view hex);
+
+} // namespace gsm
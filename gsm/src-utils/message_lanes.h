@@ -0,0 +1,268 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   message_lanes.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <array>
+#include <cstddef>
+#include <inttypes.h>
+#include <optional>
+#include <type_traits>
+
+/**
+ * @brief counters of MessageLanes, read at runtime
+ *
+ */
+struct LaneStats
+{
+    uint32_t _controlHighWater{0};  ///< the most control messages waiting
+    uint32_t _controlDrops{0};      ///< control lane full
+    uint32_t _coalesced{0};         ///< view messages replaced by a newer one of the same key
+    uint32_t _viewDrops{0};         ///< no free view slot
+};
+
+/**
+ * @brief inter-task request queue with two lanes. The control lane (output writes, acknowledgements,
+ * received characters) is a FIFO with its own capacity and it is always read first. The view lane keeps
+ * one slot per key (e.g. the message type), a newer message replaces the waiting one - the latest wins.
+ * The receiving task waits for the doorbell semaphore, alone or in its queue set.
+ *
+ * @tparam T - message, copied in a critical section
+ * @tparam Control - capacity of the control lane
+ * @tparam View - view slots, different keys
+ */
+template <typename T, std::size_t Control, std::size_t View>
+class MessageLanes
+{
+    static_assert(std::is_trivially_copyable_v<T>, "the message is copied in a critical section");
+
+public:
+    static constexpr std::size_t capacity{Control + View};     ///< messages waiting at most
+
+    MessageLanes() : _doorbell(xSemaphoreCreateBinary()) {}
+
+    ~MessageLanes()
+    {
+        if (_doorbell)
+            vSemaphoreDelete(_doorbell);
+    }
+
+    MessageLanes(const MessageLanes &) = delete;
+    MessageLanes &operator=(const MessageLanes &) = delete;
+
+    /**
+     * @brief control message, never replaced by another one
+     *
+     * @param msg
+     * @param isr - called from an interrupt
+     * @param reserve - slots kept free for the other messages, e.g. a burst of received characters
+     *                  does not take the last slots of the acknowledgements
+     * @param posted - optional, the control messages queued so far including this one,
+     *                 the receiver counts them in the same order
+     * @return true - queued
+     * @return false - the lane is full, counted in LaneStats::_controlDrops
+     */
+    bool post(const T &msg, bool isr, std::size_t reserve = 0, uint32_t *posted = nullptr)
+    {
+        bool rc = false;
+        auto state = lock(isr);
+        if (_count + reserve < Control)
+        {
+            _control[(_head + _count) % Control] = msg;
+            _count++;
+            _posted++;
+            if (posted)
+                *posted = _posted;
+            if (_count > _stats._controlHighWater)
+                _stats._controlHighWater = (uint32_t)_count;
+            rc = true;
+        }
+        else
+        {
+            _stats._controlDrops++;
+        }
+        unlock(isr, state);
+
+        if (rc)
+            ring(isr);
+        return rc;
+    }
+
+    /**
+     * @brief view message, replaces the waiting one with the same key
+     *
+     * @param msg
+     * @param key - e.g. the message type
+     * @param isr - called from an interrupt
+     * @param replaced - optional, the replaced message, e.g. to release its resources
+     * @return true - queued or replaced
+     * @return false - no free slot, counted in LaneStats::_viewDrops
+     */
+    bool postView(const T &msg, uint32_t key, bool isr, std::optional<T> *replaced = nullptr)
+    {
+        bool rc = false;
+        auto state = lock(isr);
+        Slot *free = nullptr;
+        for (auto &slot : _view)
+        {
+            if (slot._used && slot._key == key)
+            {
+                if (replaced)
+                    *replaced = slot._msg;
+                slot._msg = msg;
+                _stats._coalesced++;
+                rc = true;
+                break;
+            }
+            if (!slot._used && !free)
+                free = &slot;
+        }
+
+        if (!rc && free)
+        {
+            *free = Slot{msg, key, _sequence++, true};
+            rc = true;
+        }
+        else if (!rc)
+        {
+            _stats._viewDrops++;
+        }
+        unlock(isr, state);
+
+        if (rc)
+            ring(isr);
+        return rc;
+    }
+
+    /**
+     * @brief the next message without waiting, control lane first, then the oldest view slot
+     *
+     * @param msg
+     * @return true - msg is valid
+     */
+    bool tryReceive(T &msg)
+    {
+        bool rc = false;
+        auto state = lock(false);
+        do
+        {
+            if (_count)
+            {
+                msg = _control[_head];
+                _head = (_head + 1) % Control;
+                _count--;
+                rc = true;
+                break;
+            }
+
+            Slot *oldest = nullptr;
+            for (auto &slot : _view)
+            {
+                if (slot._used && (!oldest || (int32_t)(slot._sequence - oldest->_sequence) < 0))
+                    oldest = &slot;
+            }
+            if (!oldest)
+                break;
+
+            msg = oldest->_msg;
+            oldest->_used = false;
+            rc = true;
+        } while (false);
+        unlock(false, state);
+        return rc;
+    }
+
+    /**
+     * @brief the next message, waits for it
+     *
+     * @param msg
+     * @param wait - [ticks]
+     * @return true - msg is valid
+     */
+    bool receive(T &msg, TickType_t wait)
+    {
+        if (tryReceive(msg))
+            return true;
+        if (!_doorbell || xSemaphoreTake(_doorbell, wait) != pdTRUE)
+            return false;
+        return tryReceive(msg);
+    }
+
+    /**
+     * @brief given with every posted message, binary - the receiver reads all waiting messages
+     *
+     * @return SemaphoreHandle_t
+     */
+    SemaphoreHandle_t doorbell() const { return _doorbell; }
+
+    /**
+     * @brief overflow counters
+     *
+     * @return LaneStats
+     */
+    LaneStats stats() const
+    {
+        auto state = lock(false);
+        auto rc = _stats;
+        unlock(false, state);
+        return rc;
+    }
+
+private:
+    struct Slot
+    {
+        T _msg;
+        uint32_t _key{0};
+        uint32_t _sequence{0};      ///< posting order of the slots
+        bool _used{false};
+    };
+
+    static UBaseType_t lock(bool isr)
+    {
+        if (isr)
+            return taskENTER_CRITICAL_FROM_ISR();
+        taskENTER_CRITICAL();
+        return 0;
+    }
+
+    static void unlock(bool isr, UBaseType_t state)
+    {
+        if (isr)
+        {
+            taskEXIT_CRITICAL_FROM_ISR(state);
+            return;
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    void ring(bool isr)
+    {
+        if (!_doorbell)
+            return;
+
+        if (isr)
+        {
+            BaseType_t woken = pdFALSE;
+            xSemaphoreGiveFromISR(_doorbell, &woken);
+            portYIELD_FROM_ISR(woken);
+            return;
+        }
+        xSemaphoreGive(_doorbell);
+    }
+
+    std::array<T, Control> _control{};
+    std::size_t _head{0};
+    std::size_t _count{0};
+    uint32_t _posted{0};            ///< control messages queued since the start
+    std::array<Slot, View> _view{};
+    uint32_t _sequence{0};
+    LaneStats _stats;
+    SemaphoreHandle_t _doorbell;
+};
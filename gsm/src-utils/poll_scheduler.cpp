@@ -0,0 +1,81 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   poll_scheduler.cpp
+/// @author Petr Vanek
+
+#include <algorithm>
+#include "poll_scheduler.h"
+
+bool PollScheduler::later(const Entry &a, const Entry &b)
+{
+    // std heap keeps the "largest" at the front, the largest is the earliest one
+    if (a._due != b._due)
+        return a._due > b._due;
+    return a._item._priority < b._item._priority;
+}
+
+uint64_t PollScheduler::period(const Item &item)
+{
+    uint64_t rc = item._periodMs;
+    if (item._jitterMs)
+    {
+        _random ^= _random << 13;
+        _random ^= _random >> 17;
+        _random ^= _random << 5;
+        rc += _random % (item._jitterMs + 1);
+    }
+    return rc * 1000ull;
+}
+
+void PollScheduler::add(const Item &item, uint64_t firstUs)
+{
+    _heap.push_back(Entry{firstUs, item});
+    std::push_heap(_heap.begin(), _heap.end(), later);
+}
+
+std::optional<uint32_t> PollScheduler::next(uint64_t nowUs, bool modemBusy)
+{
+    std::optional<uint32_t> rc;
+    while (!_heap.empty() && _heap.front()._due <= nowUs)
+    {
+        std::pop_heap(_heap.begin(), _heap.end(), later);
+        auto &entry = _heap.back();
+        if (modemBusy && entry._item._modem)
+        {
+            entry._due = nowUs + _deferMs * 1000ull;
+            std::push_heap(_heap.begin(), _heap.end(), later);
+            _deferred++;
+            continue;
+        }
+
+        // the phase is kept, a long delay is not caught up
+        entry._due += period(entry._item);
+        if (entry._due <= nowUs)
+            entry._due = nowUs + period(entry._item);
+        rc = entry._item._id;
+        std::push_heap(_heap.begin(), _heap.end(), later);
+        _polls++;
+        break;
+    }
+    return rc;
+}
+
+void PollScheduler::reschedule(uint32_t id, uint64_t dueUs)
+{
+    auto it = std::find_if(_heap.begin(), _heap.end(), [id](const Entry &e)
+                           { return e._item._id == id; });
+    if (it == _heap.end())
+        return;
+
+    it->_due = dueUs;
+    std::make_heap(_heap.begin(), _heap.end(), later);
+}
+
+void PollScheduler::restart(uint64_t nowUs)
+{
+    for (auto &entry : _heap)
+        entry._due = nowUs;
+    std::make_heap(_heap.begin(), _heap.end(), later);
+}
@@ -0,0 +1,99 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   poll_scheduler.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief periodic polls, each item has its own period, jitter and priority.
+ * The items are kept in a binary heap ordered by the due time, the next due item
+ * is found in O(1), taken and rescheduled in O(log n).
+ *
+ */
+class PollScheduler
+{
+public:
+    /**
+     * @brief polled item
+     *
+     */
+    struct Item
+    {
+        uint32_t _id{0};            ///< bit of the item, e.g. gsm::Telemetry::signal
+        uint32_t _periodMs{0};      ///< from the previous due time
+        uint32_t _jitterMs{0};      ///< random part added to the period, the items do not stay aligned
+        uint8_t _priority{0};       ///< higher is taken first if the items are due at the same time
+        bool _modem{true};          ///< requires the modem, deferred while it is busy
+    };
+
+    /**
+     * @brief new item
+     *
+     * @param item
+     * @param firstUs - the first due time [us]
+     */
+    void add(const Item &item, uint64_t firstUs);
+
+    /**
+     * @brief the next due item, it is rescheduled by its period
+     *
+     * @param nowUs - current time [us]
+     * @param modemBusy - the modem items are deferred by _deferMs
+     * @return std::optional<uint32_t> - item id, std::nullopt - nothing is due
+     */
+    std::optional<uint32_t> next(uint64_t nowUs, bool modemBusy);
+
+    /**
+     * @brief moves the item, e.g. an adaptive period given by its result
+     *
+     * @param id - item id
+     * @param dueUs - the new due time [us]
+     */
+    void reschedule(uint32_t id, uint64_t dueUs);
+
+    /**
+     * @brief all items are due, e.g. after the modem restart
+     *
+     * @param nowUs - current time [us]
+     */
+    void restart(uint64_t nowUs);
+
+    /**
+     * @brief the nearest due time
+     *
+     * @return uint64_t - [us], UINT64_MAX - no items
+     */
+    uint64_t nextDueUs() const
+    {
+        return _heap.empty() ? UINT64_MAX : _heap.front()._due;
+    }
+
+    std::size_t size() const { return _heap.size(); }
+    uint32_t polls() const { return _polls; }           ///< items taken
+    uint32_t deferred() const { return _deferred; }     ///< items deferred by the busy modem
+
+private:
+    static constexpr uint32_t _deferMs{1000};   ///< the busy modem is asked again
+
+    struct Entry
+    {
+        uint64_t _due{0};
+        Item _item;
+    };
+
+    static bool later(const Entry &a, const Entry &b);
+    uint64_t period(const Item &item);
+
+    std::vector<Entry> _heap;           ///< the nearest due time first
+    uint32_t _random{0x2545f491};       ///< xorshift state of the jitter
+    uint32_t _polls{0};
+    uint32_t _deferred{0};
+};
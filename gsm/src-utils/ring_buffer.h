@@ -0,0 +1,152 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   ring_buffer.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief lock-free single producer / single consumer ring buffer
+ *        The producer is typically an ISR, the consumer is a task.
+ *        Only the producer moves the head, only the consumer moves the tail.
+ *
+ * @tparam T - item type
+ * @tparam Size - capacity, must be power of two
+ */
+template <typename T, std::size_t Size>
+class RingBuffer
+{
+    static_assert(Size != 0 && (Size & (Size - 1)) == 0, "ring buffer size must be power of two");
+
+public:
+    /**
+     * @brief insert item, producer side
+     *
+     * @param item
+     * @return true - stored
+     * @return false - buffer is full, item is dropped and counted as overrun
+     */
+    bool push(const T &item)
+    {
+        auto head = _head.load(std::memory_order_relaxed);
+        auto tail = _tail.load(std::memory_order_acquire);
+        auto used = head - tail;
+
+        if (used >= Size)
+        {
+            // single producer, no read-modify-write, Cortex-M0+ has no atomic instructions for it
+            _overruns.store(_overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        _data[head & (Size - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+
+        if (used + 1 > _highWater.load(std::memory_order_relaxed))
+            _highWater.store(used + 1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    /**
+     * @brief remove the oldest item, consumer side
+     *
+     * @param item - output
+     * @return true - item is valid
+     * @return false - buffer is empty
+     */
+    bool pop(T &item)
+    {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire))
+            return false;
+
+        item = _data[tail & (Size - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief bulk remove, consumer side. Copies items up to and including the delimiter
+     *
+     * @param items - output buffer
+     * @param size - output buffer capacity
+     * @param delimiter - copying stops after this item
+     * @return std::size_t - number of copied items
+     */
+    std::size_t pop(T *items, std::size_t size, const T &delimiter)
+    {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        auto head = _head.load(std::memory_order_acquire);
+        std::size_t count = 0;
+
+        while (tail != head && count < size)
+        {
+            auto item = _data[tail & (Size - 1)];
+            items[count++] = item;
+            tail++;
+            if (item == delimiter)
+                break;
+        }
+
+        _tail.store(tail, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief drop all stored items, consumer side
+     *
+     */
+    void clear()
+    {
+        _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity()
+    {
+        return Size;
+    }
+
+    /**
+     * @brief number of items dropped because the buffer was full
+     *
+     * @return uint32_t
+     */
+    uint32_t overruns() const
+    {
+        return _overruns.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief maximum of simultaneously stored items
+     *
+     * @return uint32_t
+     */
+    uint32_t highWater() const
+    {
+        return _highWater.load(std::memory_order_relaxed);
+    }
+
+private:
+    T _data[Size];                     ///< storage
+    std::atomic<uint32_t> _head{0};    ///< write position, owned by producer
+    std::atomic<uint32_t> _tail{0};    ///< read position, owned by consumer
+    std::atomic<uint32_t> _overruns{0}; ///< dropped items, written by producer
+    std::atomic<uint32_t> _highWater{0};///< maximum fill level
+};
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include "time_base.h"
+#include "time_utils.h"
 
 TimeBase::TimeBase()
 {
@@ -46,64 +47,91 @@ bool TimeBase::isValid() const {
 }
 
 bool TimeBase::updateTime(datetime_t &dt) {
-    return rtc_set_datetime(&dt);
+    auto rc = rtc_set_datetime(&dt);
+    if (rc && dt.year >= 1970)
+    {
+        _epochUs = (int64_t)TimeUtils::makeUnixTime(dt) * 1000000ll;
+        _epochLocal = time_us_64();
+    }
+    return rc;
 }
 
 datetime_t TimeBase::getTimeDate() {
+    return snapshot()._dt;
+}
+
+bool TimeBase::sample(int64_t utcUs, uint64_t localUs, uint32_t windowUs)
+{
+    auto rc = _clock.sample(utcUs, localUs, windowUs);
+
+    // the RTC has a second resolution and ticks apart of time_us_64(), a difference
+    // of one second is the phase of the two clocks, not an error
     datetime_t t;
-    auto r = rtc_get_datetime(&t);
-    if (!r) memset(&t, 0, sizeof(datetime_t));
-    return t;
+    auto utc = (uint32_t)(_clock.utcUs(time_us_64()) / 1000000);
+    if (!rtc_get_datetime(&t) || t.year < 2000 ||
+        llabs((int64_t)TimeUtils::makeUnixTime(t) - (int64_t)utc) > _rtcTolerance)
+    {
+        TimeUtils::breakUnixTime(utc, t);
+        updateTime(t);
+    }
+    return rc;
+}
+
+TimeSnapshot TimeBase::snapshot(uint64_t localUs) const
+{
+    TimeSnapshot rc;
+    rc._localUs = localUs;
+    if (_clock.isValid() || _epochUs >= 0)
+    {
+        rc._utcUs = _clock.isValid() ? _clock.utcUs(localUs) : _epochUs + (int64_t)(localUs - _epochLocal);
+        TimeUtils::breakUnixTime((uint32_t)(rc._utcUs / 1000000), rc._dt);
+    }
+    else if (rtc_get_datetime(&rc._dt))
+    {
+        // not disciplined (other task, no samples yet), whole seconds of the RTC
+        rc._utcUs = (rc._dt.year < 1970) ? 0 : (int64_t)TimeUtils::makeUnixTime(rc._dt) * 1000000ll;
+    }
+    return rc;
 }
 
+TimeSnapshot TimeBase::snapshot() const
+{
+    return snapshot(time_us_64());
+}
 
 int16_t TimeBase::year() const
 {
-    datetime_t t;
-    auto r = rtc_get_datetime(&t);	
-    return (r ? t.year : -1);
+    return snapshot()._dt.year;
 }
 
 int8_t TimeBase::month() const
 {
-    datetime_t t;
-    auto r = rtc_get_datetime(&t);	
-    return (r ? t.month : -1);
+    return snapshot()._dt.month;
 }
 
 int8_t TimeBase::day() const
 {
-    datetime_t t;
-    auto r = rtc_get_datetime(&t);	
-    return (r ? t.day : -1);
+    return snapshot()._dt.day;
 }
 
 int8_t TimeBase::hour() const
 {
-   datetime_t t;
-    auto r = rtc_get_datetime(&t);	
-    return (r ? t.hour : -1);
+    return snapshot()._dt.hour;
 }
 
 int8_t TimeBase::minute() const
 {
-    datetime_t t;
-    auto r = rtc_get_datetime(&t);	
-    return (r ? t.min : -1);
+    return snapshot()._dt.min;
 }
 
 int8_t TimeBase::second() const
 {
-    datetime_t t;
-    auto r = rtc_get_datetime(&t);	
-    return (r ? t.sec : -1);
+    return snapshot()._dt.sec;
 }
 
 int8_t TimeBase::weekDay() const
 {
-    datetime_t t;
-    auto r = rtc_get_datetime(&t);	
-    return (r ? t.dotw : -1);
+    return snapshot()._dt.dotw;
 }
 
 bool TimeBase::setYear(int16_t val)
@@ -12,10 +12,25 @@
 #include "hardware/rtc.h"
 #include "pico/stdlib.h"
 #include "pico/util/datetime.h"
+#include "time_discipline.h"
+
+/**
+ * @brief one reading of the time, all the values belong to the same instant
+ *
+ */
+struct TimeSnapshot
+{
+    int64_t _utcUs{0};      ///< [us] since 1.1.1970
+    uint64_t _localUs{0};   ///< time_us_64() of the snapshot
+    datetime_t _dt{};       ///< _utcUs broken down, second resolution
+};
 
 /**
  * @brief - encapsulates the basic real-time control clock in the rp2040
  *        - Basically it works with 0 - 24 hour cycle.
+ *        - the time is one 64-bit UTC value derived from time_us_64(): disciplined by the time samples (sample),
+ *          or the epoch of the last updateTime plus the elapsed time, otherwise the RTC seconds are read.
+ *          The RTC follows the disciplined time.
  */
 class TimeBase
 {
@@ -26,6 +41,39 @@ public:
     bool init();
     bool updateTime(datetime_t &dt);
     datetime_t getTimeDate();
+
+    /**
+     * @brief reference time sample, see TimeDiscipline::sample, the RTC is set
+     * only if it differs by more than _rtcTolerance from the disciplined time
+     *
+     * @param utcUs - reference UTC [us]
+     * @param localUs - time_us_64() of the reference
+     * @param windowUs - the true time lies in <utcUs, utcUs + windowUs)
+     * @return true - the time has been stepped
+     */
+    bool sample(int64_t utcUs, uint64_t localUs, uint32_t windowUs);
+
+    /**
+     * @brief consistent time of the local instant, one RTC read at most
+     *
+     * @param localUs - time_us_64(), e.g. taken in the interrupt
+     * @return TimeSnapshot
+     */
+    TimeSnapshot snapshot(uint64_t localUs) const;
+
+    /**
+     * @brief consistent time now
+     *
+     * @return TimeSnapshot
+     */
+    TimeSnapshot snapshot() const;
+
+    /**
+     * @brief the clock corrected by the time samples
+     *
+     * @return const TimeDiscipline&
+     */
+    const TimeDiscipline &discipline() const { return _clock; }
    
     /**
      * @brief reads year
@@ -135,6 +183,8 @@ public:
 
    
 private:
-   
-   
+    static constexpr int64_t _rtcTolerance{1};  ///< [s] RTC difference kept by sample
+    TimeDiscipline _clock;      ///< UTC from time_us_64(), valid after the first sample
+    int64_t _epochUs{-1};       ///< [us] UTC of the last updateTime, -1 - not set by this instance
+    uint64_t _epochLocal{0};    ///< time_us_64() of the last updateTime
 };
@@ -0,0 +1,135 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   time_discipline.cpp
+/// @author Petr Vanek
+
+#include <algorithm>
+#include <cstdlib>
+#include "time_discipline.h"
+
+namespace {
+
+constexpr int64_t C_PPB{1000000000};
+
+} // namespace
+
+int64_t TimeDiscipline::base(uint64_t localUs) const
+{
+    auto dt = (int64_t)(localUs - _refLocal);
+    return _refUtc + dt + dt * _driftPpb / C_PPB;
+}
+
+int64_t TimeDiscipline::slewed(uint64_t localUs) const
+{
+    // part of the correction applied since the last sample, at most _maxSlewPpb
+    auto dt = (int64_t)(localUs - _refLocal);
+    if (dt <= 0 || _slewUs == 0)
+        return 0;
+
+    auto done = dt * _maxSlewPpb / C_PPB;
+    return (_slewUs > 0) ? std::min(done, _slewUs) : std::max(-done, _slewUs);
+}
+
+int64_t TimeDiscipline::utcUs(uint64_t localUs) const
+{
+    return base(localUs) + slewed(localUs);
+}
+
+bool TimeDiscipline::sample(int64_t utcUs, uint64_t localUs, uint32_t windowUs)
+{
+    bool rc = false;
+    _samples++;
+    do
+    {
+        if (!_valid)
+        {
+            // the middle of the window, nothing better is known
+            _valid = true;
+            _refUtc = utcUs + windowUs / 2;
+            _refLocal = localUs;
+            _slewUs = 0;
+            _lo = -(int64_t)(windowUs / 2);
+            _hi = (int64_t)(windowUs - windowUs / 2);
+            _offsetUs = 0;
+            _pollMs = _minPollMs;
+            _steps++;
+            rc = true;
+            break;
+        }
+
+        // older than the last one, e.g. a delayed message
+        if (localUs < _refLocal)
+            break;
+
+        // new reference point, the time stays continuous, the rest of the correction continues
+        auto elapsed = (int64_t)(localUs - _refLocal);
+        auto consumed = slewed(localUs);
+        _refUtc = base(localUs) + consumed;
+        _slewUs -= consumed;
+        _refLocal = localUs;
+
+        // the bracket relates to the clock with the whole correction applied
+        auto target = _refUtc + _slewUs;
+        auto aging = elapsed * _agingNowPpb / C_PPB;
+        _lo -= aging;
+        _hi += aging;
+
+        int64_t lo = utcUs - target;
+        int64_t hi = utcUs + windowUs - target;
+        if (lo > _hi || hi < _lo)
+        {
+            // inconsistent with the history, e.g. the network time changed
+            _lo = lo;
+            _hi = hi;
+            _anchorLocal = 0;
+        }
+        else
+        {
+            _lo = std::max(_lo, lo);
+            _hi = std::min(_hi, hi);
+        }
+
+        auto offset = (_lo + _hi) / 2;
+        _offsetUs = offset;
+        _lo -= offset;
+        _hi -= offset;
+
+        if (offset > _stepUs || offset < -_stepUs)
+        {
+            _refUtc += _slewUs + offset;
+            _slewUs = 0;
+            _anchorLocal = 0;
+            _pollMs = _minPollMs;
+            _steps++;
+            rc = true;
+            break;
+        }
+
+        // corrections over a long period are the frequency error, the single one is mostly the bracket noise
+        bool narrow = _hi - _lo <= 2 * _stableUs;
+        if (!_anchorLocal)
+        {
+            _anchorLocal = localUs;
+            _anchorSum = 0;
+        }
+        else
+        {
+            _anchorSum += offset;
+            auto baseline = (int64_t)(localUs - _anchorLocal);
+            if (baseline >= _baselineUs)
+            {
+                auto drift = std::clamp(_driftPpb + _anchorSum * C_PPB / baseline / 2, -_maxDriftPpb, _maxDriftPpb);
+                _agingNowPpb = std::max(_agingPpb, 2 * std::abs(drift - _driftPpb));
+                _driftPpb = (int32_t)drift;
+                _anchorLocal = localUs;
+                _anchorSum = 0;
+            }
+        }
+
+        _slewUs += offset;
+        _pollMs = (narrow && offset < _stableUs && offset > -_stableUs) ? std::min(_pollMs * 2, _maxPollMs) : _minPollMs;
+    } while (false);
+    return rc;
+}
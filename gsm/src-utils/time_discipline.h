@@ -0,0 +1,82 @@
+//
+// vim: ts=4 et
+// Copyright (c) 2023 Petr Vanek, petr@fotoventus.cz
+//
+/// @file   time_discipline.h
+/// @author Petr Vanek
+
+#pragma once
+
+#include <inttypes.h>
+
+/**
+ * @brief UTC derived from the local microsecond counter (time_us_64), corrected by reference samples
+ * (modem RTC, GNSS). The offset is bracketed by the sample windows, small errors are slewed,
+ * the drift of the local oscillator is estimated, the time is stepped only by the first sample
+ * or by a large error. The required sampling period grows while the clock is stable.
+ *
+ */
+class TimeDiscipline
+{
+public:
+    /**
+     * @brief reference sample, the true UTC at localUs lies in [utcUs, utcUs + windowUs)
+     *
+     * @param utcUs - reference time [us], e.g. AT+CCLK? seconds
+     * @param localUs - local time of the sample [us]
+     * @param windowUs - resolution of the reference and the transport delay [us]
+     * @return true - the clock has been stepped (the first sample or the error over _stepUs)
+     */
+    bool sample(int64_t utcUs, uint64_t localUs, uint32_t windowUs);
+
+    /**
+     * @brief UTC of the local time, continuous and monotonic between the steps
+     *
+     * @param localUs - e.g. time_us_64()
+     * @return int64_t - [us] since 1.1.1970, valid only if isValid()
+     */
+    int64_t utcUs(uint64_t localUs) const;
+
+    /**
+     * @brief the next reference sample is useful after this period, the sub-second part
+     * moves the sampling phase, so the whole second references narrow the bracket
+     *
+     * @return uint32_t [ms]
+     */
+    uint32_t pollIntervalMs() const { return _pollMs + (_samples * 618) % 1000; }
+
+    bool isValid() const { return _valid; }
+    int32_t driftPpb() const { return _driftPpb; }          ///< estimated local oscillator error [1e-9]
+    int64_t offsetUs() const { return _offsetUs; }          ///< correction of the last sample
+    uint32_t uncertaintyUs() const { return (uint32_t)(_hi - _lo); }   ///< width of the offset bracket
+    uint32_t samples() const { return _samples; }
+    uint32_t steps() const { return _steps; }
+
+private:
+    static constexpr int64_t _stepUs{2000000};          ///< larger error is stepped
+    static constexpr int64_t _maxSlewPpb{500000};       ///< 0.5 ms per second
+    static constexpr int64_t _maxDriftPpb{200000};      ///< crystal and temperature
+    static constexpr int64_t _agingPpb{50000};          ///< the least uncertainty of the drift estimate
+    static constexpr int64_t _stableUs{100000};         ///< bracket and correction to lengthen the period
+    static constexpr int64_t _baselineUs{3600000000};   ///< the drift is evaluated over this period
+    static constexpr uint32_t _minPollMs{30000};
+    static constexpr uint32_t _maxPollMs{480000};
+
+    int64_t base(uint64_t localUs) const;
+    int64_t slewed(uint64_t localUs) const;
+
+    bool _valid{false};
+    int64_t _refUtc{0};             ///< [us] UTC at _refLocal
+    uint64_t _refLocal{0};          ///< [us] the last sample
+    int64_t _slewUs{0};             ///< correction applied from _refLocal
+    int32_t _driftPpb{0};
+    int64_t _agingNowPpb{_maxDriftPpb};     ///< the bracket widens with the drift uncertainty
+    uint64_t _anchorLocal{0};       ///< [us] start of the drift baseline, 0 - none
+    int64_t _anchorSum{0};          ///< [us] corrections since _anchorLocal
+    int64_t _lo{0};                 ///< offset bracket of the corrected clock [us]
+    int64_t _hi{0};
+    int64_t _offsetUs{0};
+    uint32_t _pollMs{_minPollMs};
+    uint32_t _samples{0};
+    uint32_t _steps{0};
+};
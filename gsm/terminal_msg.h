@@ -10,6 +10,9 @@
 
 #include <stdio.h>
 #include <string>
+#include <vector>
+#include "message_bus.h"
+#include "src-gsm/at_trace.h"
 
 
 using namespace std::literals;
@@ -17,10 +20,11 @@ using namespace std::literals;
 enum class TerminalMessageType
 {
 	none,		/// none
-    receive,	///< receive char, from Application ISR  -> terminal task 
-	rtcset, 	///< from Gsm task -> terminal task 
+    receive,	///< receive char, from Application ISR  -> terminal task, _stamp time of the reception
+	rtcset, 	///< from Gsm task -> terminal task, time sample: _ref TimeSample
 	clearAllAck, ///< from Output task -> terminal task, ack clear output
-	readAllAck,   ///< from Output task -> terminal task, ack read output
+	trace,		///< from Gsm task -> terminal task, AT trace copy: _trace, _value bit 0 - checksum
+	outputs,	///< Topic::outputState received, a waiting read command is answered
 
 };
 
@@ -30,4 +34,18 @@ struct TerminalMessage
     TerminalMessageType  _messageType{TerminalMessageType::none};
     char            	 _c{'\0'};
     uint64_t         	 _value{0};
+    uint64_t         	 _stamp{0};		///< [us] local time_us_64() of the received char
+    BusRef           	 _ref;			///< MessageBus buffer, released by the terminal task
+    std::vector<gsm::TraceRecord> *_trace{nullptr};	///< TerminalMessageType::trace, deleted by the terminal task
+};
+
+/**
+ * @brief Topic::time, reference time sample for the terminal clock
+ *
+ */
+struct TimeSample
+{
+    int64_t         	 _utcUs{0};		///< reference UTC [us]
+    uint64_t        	 _stamp{0};		///< [us] local time_us_64() of the sample
+    uint32_t        	 _window{0};	///< [us] the true time lies in <_utcUs, _utcUs + _window)
 };
\ No newline at end of file
@@ -31,6 +31,10 @@ using namespace std::literals;
            C, c - clear output status  (0 - 255) set the bits to be reset
            T, t - get time
            A, a - get human readable datetime - UTC
+           M, m - get time in milliseconds - UTC, the time when the last character of the request
+                  was received (interrupt), the reply does not depend on the processing delay
+           D, d - dump the AT traffic trace of the GSM modem, value 1 - clear the trace after the dump
+                  one response per record: TD<timestamp us> <T|R> <hex data>; closed by the empty response TD;
 
        Response:
            Address|Command|value number;<Checksum>
@@ -53,6 +57,10 @@ public:
     static const char _clear{'C'};
     static const char _asciiTimeChck{'a'};
     static const char _asciiTime{'A'};
+    static const char _traceChck{'d'};
+    static const char _trace{'D'};
+    static const char _msTimeChck{'m'};
+    static const char _msTime{'M'};
 
     enum class Cmd
     {
@@ -60,6 +68,8 @@ public:
         clear,
         time,
         ascitime,
+        trace,
+        mstime,
         none
     };
 
@@ -236,6 +246,28 @@ public:
                     _step = Step::semicolon;
                     break;
 
+                case 'd':
+                    _cmd = Cmd::trace;
+                    _chceksum = true;
+                    _step = Step::semicolon;
+                    break;
+
+                case 'D':
+                    _cmd = Cmd::trace;
+                    _step = Step::semicolon;
+                    break;
+
+                case 'm':
+                    _cmd = Cmd::mstime;
+                    _chceksum = true;
+                    _step = Step::semicolon;
+                    break;
+
+                case 'M':
+                    _cmd = Cmd::mstime;
+                    _step = Step::semicolon;
+                    break;
+
 
 
 
@@ -11,6 +11,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <memory>
 #include "terminal_task.h"
 #include "pico/stdlib.h"
 #include "src-utils/time_utils.h"
@@ -20,15 +21,12 @@
 
 TerminalTask::TerminalTask()
 {
-	_queue = xQueueCreate(10, sizeof(TerminalMessage));
 	_timebase.init();
 }
 
 TerminalTask::~TerminalTask()
 {
 	done();
-	if (_queue)
-		vQueueDelete(_queue);
 }
 
 void TerminalTask::message(const char ch, bool isr)
@@ -36,18 +34,48 @@ void TerminalTask::message(const char ch, bool isr)
 	TerminalMessage tm;
 	tm._c = ch;
 	tm._messageType = TerminalMessageType::receive;
-	if (_queue)
-	{
-		(isr) ? xQueueSendToBackFromISR(_queue, (void *)&tm, 0) : xQueueSendToBack(_queue, (void *)&tm, 0);
-	}
+	tm._stamp = time_us_64();	// the request time does not depend on the queue and the task latency
+	_lanes.post(tm, isr, _ackReserve);	// the acknowledgements and the trace are not lost by a burst
+}
+
+bool TerminalTask::message(const TerminalMessage &msg, bool isr)
+{
+	if (msg._messageType != TerminalMessageType::rtcset && msg._messageType != TerminalMessageType::outputs)
+		return _lanes.post(msg, isr);
+
+	// the newest sample, the replaced one is not needed any more
+	std::optional<TerminalMessage> replaced;
+	auto rc = _lanes.postView(msg, (uint32_t)msg._messageType, isr, &replaced);
+	if (replaced.has_value())
+		Application::getInstance()->getBus()->release(replaced->_ref, isr);
+	return rc;
 }
 
-void TerminalTask::message(const TerminalMessage &msg, bool isr)
+bool TerminalTask::onBus(void *context, Topic topic, BusRef ref, bool isr)
 {
-	if (_queue)
+	auto self = static_cast<TerminalTask *>(context);
+	if (topic == Topic::outputState)
 	{
-		(isr) ? xQueueSendToBackFromISR(_queue, (void *)&msg, 0) : xQueueSendToBack(_queue, (void *)&msg, 0);
+		// published by the Output task only, the read command is answered without a round trip
+		if (auto state = Application::getInstance()->getBus()->get<OutputState>(ref))
+		{
+			taskENTER_CRITICAL();
+			if ((int32_t)(state->_seq - self->_outputs._seq) > 0)
+				self->_outputs = *state;
+			taskEXIT_CRITICAL();
+
+			// a read may wait for this state
+			TerminalMessage msg;
+			msg._messageType = TerminalMessageType::outputs;
+			self->message(msg, isr);
+		}
+		return false;
 	}
+
+	TerminalMessage msg;
+	msg._messageType = TerminalMessageType::rtcset;
+	msg._ref = ref;
+	return self->message(msg, isr);
 }
 
 void TerminalTask::loop()
@@ -58,26 +86,26 @@ void TerminalTask::loop()
 	while (true)
 	{ // Loop forever
 
-		auto res = xQueueReceive(_queue, (void *)&req, (TickType_t)50 / portTICK_PERIOD_MS);
-		if (res == pdTRUE)
+		if (_lanes.receive(req, (TickType_t)50 / portTICK_PERIOD_MS))
 		{
 			if (req._messageType == TerminalMessageType::receive)
 			{
 				if (_proto.parse(req._c))
 				{
+					// the time of the request, the last received character
+					auto now = _timebase.snapshot(req._stamp);
 
 					switch (_proto.getCommand())
 					{
 
 					case TerminalProto::Cmd::ascitime:
-						if (_timebase.isValid())
+						if (now._dt.year > 2000)
 						{
 							// real time is valid and print as ascii string
-							auto tmbs = _timebase.getTimeDate();
 							std::string tmstr;
-							tmstr = TimeUtils::timeToString(tmbs);
+							tmstr = TimeUtils::timeToString(now._dt);
 							tmstr += " ";
-							tmstr += TimeUtils::dateToString(tmbs);
+							tmstr += TimeUtils::dateToString(now._dt);
 							auto response = TerminalProto::makeResponse(_proto._address, _proto.isChecksumRequired() ? TerminalProto::_asciiTimeChck : TerminalProto::_asciiTime, tmstr, _proto.isChecksumRequired());
 							printf("%s\r\n", response.c_str());
 						}
@@ -91,11 +119,10 @@ void TerminalTask::loop()
 
 					case TerminalProto::Cmd::time:
 
-						if (_timebase.isValid())
+						if (now._dt.year > 2000)
 						{
 							// real time is valid
-							auto tmbs = _timebase.getTimeDate();
-							auto unixtime = TimeUtils::makeUnixTime(tmbs);
+							auto unixtime = (uint32_t)(now._utcUs / 1000000);
 							auto response = TerminalProto::makeResponse(_proto._address, _proto.isChecksumRequired() ? TerminalProto::_timeChck : TerminalProto::_time, unixtime, _proto.isChecksumRequired());
 							printf("%s\r\n", response.c_str());
 						}
@@ -108,13 +135,22 @@ void TerminalTask::loop()
 
 						break;
 
-					case TerminalProto::Cmd::read:
-						// send message to Output task
+					case TerminalProto::Cmd::mstime:
+						{
+							// empty value - not valid time
+							auto valid = now._dt.year > 2000;
+							auto chck = _proto.isChecksumRequired();
+							auto response = valid ? TerminalProto::makeResponse(_proto._address, chck ? TerminalProto::_msTimeChck : TerminalProto::_msTime, std::to_string(now._utcUs / 1000), chck)
+												  : TerminalProto::makeResponse(_proto._address, chck ? TerminalProto::_msTimeChck : TerminalProto::_msTime, chck);
+							printf("%s\r\n", response.c_str());
+						}
+						break;
 
-						msgx._output = 0;
-						msgx._value = false;
-						msgx._messageType = OutputTypeMsg::readallTerm;
-						Application::getInstance()->getOutputTask()->message(msgx, false);
+					case TerminalProto::Cmd::read:
+						// the latest published state, after the writes of this task
+						_readPending = true;
+						_readChecksum = _proto.isChecksumRequired();
+						replyRead();
 						break;
 
 					case TerminalProto::Cmd::clear:
@@ -122,19 +158,47 @@ void TerminalTask::loop()
 						msgx._output = 0;
 						msgx._value = false;
 						msgx._messageType = OutputTypeMsg::writeAllOffTerm;
-						Application::getInstance()->getOutputTask()->message(msgx, false);
+						if (auto seq = Application::getInstance()->getOutputTask()->message(msgx, false))
+							_written = seq;
 						break;
 
+					case TerminalProto::Cmd::trace:
+						// the trace is owned by the GSM task, its copy comes back as TerminalMessageType::trace
+						{
+							GSMMessage gsmmsg;
+							gsmmsg._messageType = GSMMessageType::trace;
+							gsmmsg._value = (_proto.isChecksumRequired() ? 1 : 0) | (_proto.getValue() == 1 ? 2 : 0);
+							Application::getInstance()->getGSMTask()->message(gsmmsg, false);
+						}
+						break;
+
+					default:
 						break;
 					}
 				}
 			}
 			else if (req._messageType == TerminalMessageType::rtcset)
 			{
-				//receive from GSM task with valid time timestamp
-				datetime_t tm;
-				TimeUtils::breakUnixTime(req._value, tm);
-				_timebase.updateTime(tm);
+				// time sample from the GSM task, slewed into the clock instead of setting the RTC
+				auto bus = Application::getInstance()->getBus();
+				if (auto sample = bus->get<TimeSample>(req._ref))
+					_timebase.sample(sample->_utcUs, sample->_stamp, sample->_window);
+				bus->release(req._ref);
+
+				// the sampling period follows the stability of the clock
+				GSMMessage gsmmsg;
+				gsmmsg._messageType = GSMMessageType::timepoll;
+				gsmmsg._value = _timebase.discipline().pollIntervalMs();
+				Application::getInstance()->getGSMTask()->message(gsmmsg, false);
+			}
+			else if (req._messageType == TerminalMessageType::outputs)
+			{
+				replyRead();
+			}
+			else if (req._messageType == TerminalMessageType::trace)
+			{
+				std::unique_ptr<std::vector<gsm::TraceRecord>> records(req._trace);
+				printTrace(*records, (req._value & 1) != 0);
 			}
 			else if (req._messageType == TerminalMessageType::clearAllAck)
 			{
@@ -143,13 +207,45 @@ void TerminalTask::loop()
 				auto response = TerminalProto::makeResponse(_proto._address, _proto.isChecksumRequired() ? TerminalProto::_clearChck : TerminalProto::_clear, (uint32_t)req._value, _proto.isChecksumRequired());
 				printf("%s\r\n", response.c_str());
 			}
-			else if (req._messageType == TerminalMessageType::readAllAck)
-			{
-				// received from Output task  - ACK of OutputTypeMsg::readallTerm
-				// It is assumed that there will be no further news of a different type. Because the master controls the communication.
-				auto response = TerminalProto::makeResponse(_proto._address, _proto.isChecksumRequired() ? TerminalProto::_readChck : TerminalProto::_read, (uint32_t)req._value, _proto.isChecksumRequired());
-				printf("%s\r\n", response.c_str());
-			}
 		}
 	}
 }
+
+void TerminalTask::replyRead()
+{
+	taskENTER_CRITICAL();
+	auto outputs = _outputs;
+	taskEXIT_CRITICAL();
+
+	// e.g. C then R, the read waits for the Output task to process the clear
+	if (!_readPending || (int32_t)(outputs._seq - _written) < 0)
+		return;
+
+	_readPending = false;
+	auto response = TerminalProto::makeResponse(_proto._address, _readChecksum ? TerminalProto::_readChck : TerminalProto::_read, OutputTask::outputsToOrder(outputs._mask), _readChecksum);
+	printf("%s\r\n", response.c_str());
+}
+
+void TerminalTask::printTrace(const std::vector<gsm::TraceRecord> &records, bool checksum)
+{
+	static constexpr char hex[]{"0123456789ABCDEF"};
+	const char cmd = checksum ? TerminalProto::_traceChck : TerminalProto::_trace;
+	std::string line;
+
+	// <us> <T|R> <hex>, the binary data (Ctrl+Z, PDU) survives the terminal
+	for (const auto &r : records)
+	{
+		line = std::to_string(r._us);
+		line += (r._dir == gsm::TraceDir::tx) ? " T " : " R ";
+		for (auto c : r.data())
+		{
+			line += hex[(uint8_t)c >> 4];
+			line += hex[(uint8_t)c & 0x0f];
+		}
+		auto response = TerminalProto::makeResponse(_proto._address, cmd, line, checksum);
+		printf("%s\r\n", response.c_str());
+	}
+
+	auto response = TerminalProto::makeResponse(_proto._address, cmd, checksum);
+	printf("%s\r\n", response.c_str());
+}
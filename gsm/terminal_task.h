@@ -11,9 +11,11 @@
 #include <task.h>
 #include <queue.h>
 #include "terminal_msg.h"
+#include "output_msg.h"
 #include "rptask.h"
 #include "terminal_proto.h"
 #include "src-utils/time_base.h"
+#include "src-utils/message_lanes.h"
 
 
 /**
@@ -26,14 +28,67 @@ public:
 	TerminalTask();
 	virtual ~TerminalTask();
 
-	void message(const TerminalMessage &msg, bool isr);
+	/**
+	 * @brief acknowledgements in the control lane, the time sample and the output state are coalesced
+	 * 
+	 * @param msg 
+	 * @param isr 
+	 * @return true - queued
+	 */
+	bool message(const TerminalMessage &msg, bool isr);
+
+	/**
+	 * @brief MessageBus subscriber, Topic::time is queued, Topic::outputState is copied
+	 * 
+	 * @param context - TerminalTask
+	 * @param topic 
+	 * @param ref - time sample is released after it is taken
+	 * @param isr 
+	 * @return true - queued
+	 */
+	static bool onBus(void *context, Topic topic, BusRef ref, bool isr);
+
+	/**
+	 * @brief received character, control lane without its last _ackReserve slots
+	 * 
+	 * @param ch 
+	 * @param isr 
+	 */
 	void message(const char ch, bool isr);
 
+	using Lanes = MessageLanes<TerminalMessage, 20, 2>;
+
+	/**
+	 * @brief request queue, overflow statistics
+	 *
+	 * @return const Lanes&
+	 */
+	const Lanes &lanes() const { return _lanes; }
+
 protected:
 	void loop() override;
 
+	/**
+	 * @brief prints the AT trace in the terminal protocol, oldest record first
+	 * 
+	 * @param records - copy of the GSM task
+	 * @param checksum - responses with the checksum
+	 */
+	void printTrace(const std::vector<gsm::TraceRecord> &records, bool checksum);
+
+	/**
+	 * @brief answers the read command once the outputs include the last write of this task
+	 * 
+	 */
+	void replyRead();
+
 private:
+	static constexpr std::size_t _ackReserve{4};	///< control slots not taken by the received characters
 	TerminalProto _proto;
-	QueueHandle_t _queue;
-	TimeBase _timebase;
+	Lanes _lanes;				///< received characters and requests
+	TimeBase _timebase;			///< UTC from time_us_64(), corrected by the GSM / GNSS time samples
+	OutputState _outputs;		///< the latest Topic::outputState, the read command
+	uint32_t _written{0};		///< OutputState::_seq of the last write of this task
+	bool _readPending{false};	///< the read command waits for _written
+	bool _readChecksum{false};	///< checksum of the waiting read response
 };